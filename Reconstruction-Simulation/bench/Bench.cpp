@@ -0,0 +1,377 @@
+#include "Simulation.h"
+#include "Action.h"
+#include "Auxiliary.h"
+#include "SelectionPolicy.h"
+#include "Snapshot.h"
+#include "SnapshotStore.h"
+#include "Stats.h"
+#include "StateView.h"
+#include "Epoch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+using namespace std;
+
+// Microbenchmarks over a configuration file (see ScenarioGenerator.cpp):
+//   bench <config_path> [--out <results.json>] [--baseline <baseline.json>] [--threshold <percent>] [--filter <text>]
+// Each benchmark is sampled several times and the median time per operation is reported.
+// With a baseline, any benchmark slower than baseline * (1 + threshold) fails the run.
+
+SnapshotStore* snapshots = nullptr;
+
+namespace {
+
+const int SAMPLES = 5;
+const uint64_t MIN_SAMPLE_NANOS = 50 * 1000 * 1000;
+const int STEPPED_TICKS = 20; // How far the plans are stepped before copying or rendering them
+const size_t LARGE_SETTLEMENT_COUNT = 1000000; // Size of the simulation whose backup is timed
+
+// Runs part of a benchmark: adds the time spent on the measured work to nanos and returns the operations done
+typedef function<uint64_t(uint64_t &nanos)> Batch;
+
+struct BenchResult {
+    string name;
+    double nsPerOp;
+    uint64_t ops;
+};
+
+// Discards everything written to it, so printing commands can be measured without a terminal
+class NullBuffer : public streambuf {
+    protected:
+        int overflow(int c) override { return c; }
+        streamsize xsputn(const char*, streamsize count) override { return count; }
+};
+
+BenchResult measure(const string &name, const Batch &batch) {
+    vector<double> samples;
+    uint64_t totalOps = 0;
+    uint64_t warmup = 0;
+    batch(warmup); // Fills the caches and the allocator before the first sample
+    for (int sample = 0; sample < SAMPLES; sample++) {
+        uint64_t nanos = 0;
+        uint64_t ops = 0;
+        while (nanos < MIN_SAMPLE_NANOS) {
+            ops += batch(nanos);
+        }
+        samples.push_back(static_cast<double>(nanos) / ops);
+        totalOps += ops;
+    }
+    sort(samples.begin(), samples.end());
+    return BenchResult{name, samples[SAMPLES / 2], totalOps};
+}
+
+Simulation steppedSimulation(const string &configPath) {
+    Simulation simulation(configPath);
+    for (int i = 0; i < STEPPED_TICKS; i++) {
+        simulation.step();
+    }
+    return simulation;
+}
+
+// Steps fresh copies of the plans for a fixed number of ticks; one operation is one Plan::step
+uint64_t planStepBatch(const Simulation &initial, uint64_t &nanos) {
+    vector<Plan> plans(initial.getPlans().begin(), initial.getPlans().end());
+    uint64_t ops = 0;
+    for (int tick = 1; tick <= STEPPED_TICKS; tick++) {
+        uint64_t start = Stats::now();
+        for (Plan &plan : plans) {
+            plan.setTick(tick);
+            plan.step();
+        }
+        nanos += Stats::now() - start;
+        ops += plans.size();
+    }
+    return ops;
+}
+
+// Steps a fresh copy of the whole simulation; one operation is one Simulation::step
+uint64_t simulationStepBatch(const Simulation &initial, bool publishing, uint64_t &nanos) {
+    Simulation simulation(initial);
+    simulation.setPublishing(publishing);
+    uint64_t start = Stats::now();
+    for (int tick = 0; tick < STEPPED_TICKS; tick++) {
+        simulation.step();
+    }
+    nanos += Stats::now() - start;
+    return STEPPED_TICKS;
+}
+
+// Reads the latest published view every READ_INTERVAL, the way a reporting thread would
+void readViews(const atomic<bool> &stop, atomic<uint64_t> &reads) {
+    const std::chrono::microseconds READ_INTERVAL(100);
+    while (!stop.load(std::memory_order_relaxed)) {
+        {
+            EpochGuard guard;
+            const StateView *view = StateView::latest();
+            long total = 0;
+            for (const shared_ptr<const PlanState> &plan : view->getPlans()) {
+                if (plan == nullptr) continue;
+                total += plan->lifeQualityScore + plan->economyScore + plan->environmentScore;
+            }
+            reads.fetch_add(total >= 0 ? 1 : 0, std::memory_order_relaxed);
+        }
+        std::this_thread::sleep_for(READ_INTERVAL);
+    }
+}
+
+uint64_t selectBatch(SelectionPolicy &policy, const FacilityCatalog &options, uint64_t &nanos) {
+    const int SELECTIONS = 1000;
+    uint64_t start = Stats::now();
+    for (int i = 0; i < SELECTIONS; i++) {
+        policy.selectFacility(options);
+    }
+    nanos += Stats::now() - start;
+    return SELECTIONS;
+}
+
+vector<string> readLines(const string &path) {
+    ifstream file(path);
+    vector<string> lines;
+    string line;
+    while (getline(file, line)) {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+vector<FacilityType> readFacilityTypes(const vector<string> &configLines) {
+    vector<FacilityType> options;
+    for (const string &line : configLines) {
+        vector<string> args = Auxiliary::parseArguments(line);
+        if (args.size() == 7 && args[0] == "facility") {
+            options.push_back(FacilityType(args[1], static_cast<FacilityCategory>(stoi(args[2])), stoi(args[3]),
+                                           stoi(args[4]), stoi(args[5]), stoi(args[6])));
+        }
+    }
+    return options;
+}
+
+vector<BenchResult> runBenchmarks(const string &configPath, const string &filter) {
+    vector<BenchResult> results;
+    auto run = [&](const string &name, const Batch &batch) {
+        if (name.find(filter) == string::npos) return;
+        results.push_back(measure(name, batch));
+        cerr << name << " done" << endl;
+    };
+
+    const vector<string> configLines = readLines(configPath);
+    const FacilityCatalog options = FacilityCatalog::intern(readFacilityTypes(configLines));
+    if (options.empty()) {
+        throw runtime_error("The configuration has no facilities");
+    }
+    const Simulation initial(configPath);
+    const Simulation stepped = steppedSimulation(configPath);
+
+    run("config_load", [&](uint64_t &nanos) {
+        uint64_t start = Stats::now();
+        Simulation *simulation = new Simulation(configPath);
+        nanos += Stats::now() - start;
+        delete simulation;
+        return uint64_t(1);
+    });
+    run("parse_arguments", [&](uint64_t &nanos) {
+        uint64_t start = Stats::now();
+        size_t parsed = 0;
+        for (const string &line : configLines) {
+            parsed += Auxiliary::parseArguments(line).size();
+        }
+        nanos += Stats::now() - start;
+        return parsed == 0 ? uint64_t(1) : uint64_t(configLines.size());
+    });
+    run("plan_step", [&](uint64_t &nanos) {
+        return planStepBatch(initial, nanos);
+    });
+
+    run("simulation_step", [&](uint64_t &nanos) {
+        return simulationStepBatch(initial, false, nanos);
+    });
+    run("simulation_step_publishing", [&](uint64_t &nanos) {
+        return simulationStepBatch(initial, true, nanos);
+    });
+    {
+        const int READERS = 4;
+        atomic<bool> stop(false);
+        atomic<uint64_t> reads(0);
+        StateView::publish(initial);
+        vector<thread> readers;
+        for (int i = 0; i < READERS; i++) {
+            readers.emplace_back(readViews, std::cref(stop), std::ref(reads));
+        }
+        run("simulation_step_publishing_4_readers", [&](uint64_t &nanos) {
+            return simulationStepBatch(initial, true, nanos);
+        });
+        stop.store(true);
+        for (thread &reader : readers) {
+            reader.join();
+        }
+    }
+
+    NaiveSelection naive;
+    BalancedSelection balanced(0, 0, 0);
+    EconomySelection economy;
+    SustainabilitySelection sustainability;
+    run("select_naive", [&](uint64_t &nanos) { return selectBatch(naive, options, nanos); });
+    run("select_balanced", [&](uint64_t &nanos) { return selectBatch(balanced, options, nanos); });
+    run("select_economy", [&](uint64_t &nanos) { return selectBatch(economy, options, nanos); });
+    run("select_sustainability", [&](uint64_t &nanos) { return selectBatch(sustainability, options, nanos); });
+
+    run("simulation_copy", [&](uint64_t &nanos) {
+        uint64_t start = Stats::now();
+        Simulation *copy = new Simulation(stepped);
+        nanos += Stats::now() - start;
+        delete copy;
+        return uint64_t(1);
+    });
+    Simulation target(initial);
+    run("simulation_assign", [&](uint64_t &nanos) {
+        uint64_t start = Stats::now();
+        target = stepped;
+        nanos += Stats::now() - start;
+        return uint64_t(1);
+    });
+
+    // The flat snapshot image, against the object-graph copy above
+    run("snapshot_capture", [&](uint64_t &nanos) {
+        uint64_t start = Stats::now();
+        Snapshot snapshot(stepped);
+        nanos += Stats::now() - start;
+        return snapshot.size() > 0 ? uint64_t(1) : uint64_t(0);
+    });
+    const Snapshot image(stepped);
+    Simulation restored(initial);
+    run("snapshot_restore", [&](uint64_t &nanos) {
+        uint64_t start = Stats::now();
+        image.restore(restored);
+        nanos += Stats::now() - start;
+        return uint64_t(1);
+    });
+
+    {
+        // Backup latency when the settlement table dominates the simulation
+        Simulation large(stepped);
+        large.reserve(LARGE_SETTLEMENT_COUNT, 0, 0);
+        for (size_t i = large.getSettlementCount(); i < LARGE_SETTLEMENT_COUNT; i++) {
+            large.addSettlement(new Settlement("BenchSettlement" + to_string(i), static_cast<SettlementType>(i % 3)));
+        }
+        run("backup_1m_settlements", [&](uint64_t &nanos) {
+            SnapshotStore store;
+            uint64_t start = Stats::now();
+            store.save("", large);
+            nanos += Stats::now() - start;
+            return uint64_t(1);
+        });
+    }
+
+    Simulation rendered(stepped);
+    NullBuffer discard;
+    run("plan_status", [&](uint64_t &nanos) {
+        streambuf *console = cout.rdbuf(&discard);
+        uint64_t start = Stats::now();
+        for (const Plan &plan : rendered.getPlans()) {
+            PrintPlanStatus(plan.getPlanId()).act(rendered);
+        }
+        nanos += Stats::now() - start;
+        cout.rdbuf(console);
+        return uint64_t(rendered.getPlans().size());
+    });
+    return results;
+}
+
+void writeResults(const string &path, const vector<BenchResult> &results) {
+    ofstream out(path);
+    out << fixed << setprecision(1);
+    out << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        out << "    {\"name\": \"" << results[i].name << "\", \"ns_per_op\": " << results[i].nsPerOp
+            << ", \"ops\": " << results[i].ops << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    if (!out) throw runtime_error("Unable to write " + path);
+}
+
+// Reads the name -> ns_per_op pairs of a file written by writeResults
+map<string, double> readBaseline(const string &path) {
+    ifstream file(path);
+    if (!file.is_open()) {
+        throw runtime_error("Unable to open baseline " + path);
+    }
+    map<string, double> baseline;
+    const string NAME = "\"name\": \"";
+    const string TIME = "\"ns_per_op\": ";
+    string line;
+    while (getline(file, line)) {
+        size_t name = line.find(NAME);
+        size_t time = line.find(TIME);
+        if (name == string::npos || time == string::npos) continue;
+        name += NAME.size();
+        baseline[line.substr(name, line.find('"', name) - name)] = stod(line.substr(time + TIME.size()));
+    }
+    return baseline;
+}
+
+// Prints every result next to its baseline; returns false if any regressed past the threshold
+bool compare(const vector<BenchResult> &results, const map<string, double> &baseline, double threshold) {
+    bool passed = true;
+    cout << left << setw(24) << "benchmark" << right << setw(14) << "ns/op" << setw(14) << "baseline" << setw(10) << "change" << endl;
+    for (const BenchResult &result : results) {
+        cout << left << setw(24) << result.name << right << fixed << setprecision(1) << setw(14) << result.nsPerOp;
+        auto previous = baseline.find(result.name);
+        if (previous == baseline.end()) {
+            cout << setw(14) << "-" << setw(10) << "new" << endl;
+            continue;
+        }
+        double change = (result.nsPerOp - previous->second) / previous->second * 100;
+        cout << setw(14) << previous->second << setw(9) << showpos << change << noshowpos << "%";
+        if (change > threshold) {
+            cout << "  REGRESSION";
+            passed = false;
+        }
+        cout << endl;
+    }
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    string outPath, baselinePath, filter;
+    double threshold = 25;
+    bool validArgs = argc >= 2 && argc % 2 == 0;
+    for (int i = 2; validArgs && i < argc; i += 2) {
+        string option = argv[i];
+        if (option == "--out") outPath = argv[i + 1];
+        else if (option == "--baseline") baselinePath = argv[i + 1];
+        else if (option == "--threshold") threshold = stod(argv[i + 1]);
+        else if (option == "--filter") filter = argv[i + 1];
+        else validArgs = false;
+    }
+    if (!validArgs) {
+        cout << "usage: bench <config_path> [--out <path>] [--baseline <path>] [--threshold <percent>] [--filter <text>]" << endl;
+        return 1;
+    }
+    try {
+        vector<BenchResult> results = runBenchmarks(argv[1], filter);
+        if (!outPath.empty()) {
+            writeResults(outPath, results);
+        }
+        map<string, double> baseline;
+        if (!baselinePath.empty()) {
+            baseline = readBaseline(baselinePath);
+        }
+        if (!compare(results, baseline, threshold)) {
+            cout << "Benchmarks regressed by more than " << threshold << "% against " << baselinePath << endl;
+            return 1;
+        }
+    } catch (const exception &e) {
+        cout << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Writes a synthetic configuration file and a matching command script:
+//   generate --config <path> --commands <path> [--settlements n] [--facilities n] [--plans n]
+//            [--policies nve:1,bal:1,eco:1,sus:1] [--steps n] [--seed n]
+// The same options and seed always produce the same files.
+
+namespace {
+
+struct ScenarioOptions {
+    ScenarioOptions()
+        : configPath(), commandsPath(), settlements(50), facilities(30), plans(300), steps(100), seed(1),
+          policies({"nve", "bal", "eco", "sus"}), weights({1, 1, 1, 1}) {}
+    string configPath;
+    string commandsPath;
+    int settlements;
+    int facilities;
+    int plans;
+    int steps;
+    unsigned seed;
+    vector<string> policies;
+    vector<int> weights;
+};
+
+// mt19937 is specified exactly by the standard; the distributions are not, so reduce by hand
+class Random {
+    public:
+        explicit Random(unsigned seed) : engine(seed) {}
+        int next(int bound) { return static_cast<int>(engine() % static_cast<uint32_t>(bound)); }
+        int between(int low, int high) { return low + next(high - low + 1); }
+    private:
+        mt19937 engine;
+};
+
+// Parses "nve:2,eco:1" into policy names and weights
+void parsePolicyMix(const string &mix, ScenarioOptions &options) {
+    options.policies.clear();
+    options.weights.clear();
+    stringstream ss(mix);
+    string entry;
+    while (getline(ss, entry, ',')) {
+        size_t colon = entry.find(':');
+        string policy = entry.substr(0, colon);
+        if (policy != "nve" && policy != "bal" && policy != "eco" && policy != "sus") {
+            throw runtime_error("Unknown policy in mix: " + policy);
+        }
+        int weight = colon == string::npos ? 1 : stoi(entry.substr(colon + 1));
+        if (weight < 0) throw runtime_error("Negative policy weight");
+        options.policies.push_back(policy);
+        options.weights.push_back(weight);
+    }
+    int total = 0;
+    for (int weight : options.weights) total += weight;
+    if (total == 0) throw runtime_error("Policy mix has no weight");
+}
+
+const string &pickPolicy(const ScenarioOptions &options, Random &random) {
+    int total = 0;
+    for (int weight : options.weights) total += weight;
+    int pick = random.next(total);
+    for (size_t i = 0; i < options.weights.size(); i++) {
+        if (pick < options.weights[i]) return options.policies[i];
+        pick -= options.weights[i];
+    }
+    return options.policies.back();
+}
+
+void writeConfig(const ScenarioOptions &options, Random &random) {
+    ofstream out(options.configPath);
+    out << "# settlement <settlement_name> <settlement_type>\n";
+    for (int i = 0; i < options.settlements; i++) {
+        out << "settlement S" << i << " " << i % 3 << "\n";
+    }
+    out << "# facility <facility_name> <category> <price> <lifeq_impact> <eco_impact> <env_impact>\n";
+    for (int i = 0; i < options.facilities; i++) {
+        out << "facility F" << i << " " << i % 3 << " " << random.between(1, 5) << " " << random.between(0, 5)
+            << " " << random.between(0, 5) << " " << random.between(0, 5) << "\n";
+    }
+    out << "# plan <settlement_name> <selection_policy>\n";
+    for (int i = 0; i < options.plans; i++) {
+        const string &policy = pickPolicy(options, random);
+        // Configuration files name the sustainability policy "env", commands name it "sus"
+        out << "plan S" << random.next(options.settlements) << " " << (policy == "sus" ? "env" : policy) << "\n";
+    }
+    if (!out) throw runtime_error("Unable to write " + options.configPath);
+}
+
+// Steps in small batches, looking at a few plans and changing a policy now and then
+void writeCommands(const ScenarioOptions &options, Random &random) {
+    ofstream out(options.commandsPath);
+    int stepped = 0;
+    while (stepped < options.steps) {
+        int batch = min(random.between(1, 5), options.steps - stepped);
+        out << "step " << batch << "\n";
+        stepped += batch;
+        for (int i = 0; i < 3; i++) {
+            out << "planStatus " << random.next(options.plans) << "\n";
+        }
+        if (random.next(4) == 0) {
+            out << "changePolicy " << random.next(options.plans) << " " << pickPolicy(options, random) << "\n";
+        }
+    }
+    out << "close\n";
+    if (!out) throw runtime_error("Unable to write " + options.commandsPath);
+}
+
+int positive(const string &value) {
+    int number = stoi(value);
+    if (number <= 0) throw runtime_error("Counts must be positive");
+    return number;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    ScenarioOptions options;
+    try {
+        if (argc % 2 == 0) throw runtime_error("Options come in pairs");
+        for (int i = 1; i < argc; i += 2) {
+            string option = argv[i];
+            string value = argv[i + 1];
+            if (option == "--config") options.configPath = value;
+            else if (option == "--commands") options.commandsPath = value;
+            else if (option == "--settlements") options.settlements = positive(value);
+            else if (option == "--facilities") options.facilities = positive(value);
+            else if (option == "--plans") options.plans = positive(value);
+            else if (option == "--steps") options.steps = positive(value);
+            else if (option == "--seed") options.seed = static_cast<unsigned>(stoul(value));
+            else if (option == "--policies") parsePolicyMix(value, options);
+            else throw runtime_error("Unknown option " + option);
+        }
+        if (options.configPath.empty() || options.commandsPath.empty()) {
+            throw runtime_error("--config and --commands are required");
+        }
+        Random random(options.seed);
+        writeConfig(options, random);
+        writeCommands(options, random);
+    } catch (const exception &e) {
+        cout << e.what() << endl;
+        cout << "usage: generate --config <path> --commands <path> [--settlements n] [--facilities n] [--plans n] "
+                "[--policies nve:1,bal:1,eco:1,sus:1] [--steps n] [--seed n]" << endl;
+        return 1;
+    }
+    return 0;
+}
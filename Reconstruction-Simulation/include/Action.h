@@ -5,6 +5,14 @@
 #include "Facility.h"
 #include "SelectionPolicy.h"
 #include "Plan.h"
+#include "SnapshotStore.h"
+#include "ThreadPool.h"
+#include "ScheduleSearch.h"
+#include "Stats.h"
+#include "Memory.h"
+#include "StateView.h"
+#include "Epoch.h"
+#include "StepRunner.h"
 
 #include <iostream>
 #include <sstream>
@@ -21,7 +29,7 @@ enum class ActionStatus{
     COMPLETED, ERROR
 };
 
-extern Simulation *backup;
+extern SnapshotStore *snapshots;
 
 class BaseAction{
     public:
@@ -31,13 +39,19 @@ class BaseAction{
         virtual const string toString() const=0;
         virtual BaseAction* clone() const = 0;
         virtual ~BaseAction() = default;
+        virtual bool isReadOnly() const;
+        virtual bool changesState() const;
+        void answer(const StateReader &state, ostream &out);
 
     protected:
         void complete();
         void error(string errorMsg);
         const string &getErrorMsg() const;
+        virtual const string render(const StateReader &state) const;
 
     private:
+        friend class Snapshot;
+        friend class CommandBatcher; // Completes coalesced steps
         string errorMsg;
         ActionStatus status;
 };
@@ -45,12 +59,16 @@ class BaseAction{
 class SimulateStep : public BaseAction {
 
     public:
-        SimulateStep(const int numOfSteps);
+        SimulateStep(const int numOfSteps, const bool async = false);
         void act(Simulation &simulation) override;
         const string toString() const override;
         SimulateStep *clone() const override;
+        bool changesState() const override;
+        int getNumOfSteps() const;
+        bool isAsync() const;
     private:
         const int numOfSteps;
+        const bool async; // Run on the simulation's background runner instead of blocking
 };
 
 class AddPlan : public BaseAction {
@@ -59,6 +77,7 @@ class AddPlan : public BaseAction {
         void act(Simulation &simulation) override;
         const string toString() const override;
         AddPlan *clone() const override;
+        bool changesState() const override;
     private:
         const string settlementName;
         const string selectionPolicy;
@@ -70,6 +89,7 @@ class AddSettlement : public BaseAction {
         AddSettlement(const string &settlementName,SettlementType settlementType);
         void act(Simulation &simulation) override;
         AddSettlement *clone() const override;
+        bool changesState() const override;
         const string toString() const override;
     private:
         const string settlementName;
@@ -83,6 +103,7 @@ class AddFacility : public BaseAction {
         AddFacility(const string &facilityName, const FacilityCategory facilityCategory, const int price, const int lifeQualityScore, const int economyScore, const int environmentScore);
         void act(Simulation &simulation) override;
         AddFacility *clone() const override;
+        bool changesState() const override;
         const string toString() const override;
     private:
         const string facilityName;
@@ -96,12 +117,20 @@ class AddFacility : public BaseAction {
 
 class PrintPlanStatus: public BaseAction {
     public:
-        PrintPlanStatus(int planId);
+        static const int FULL = -1;
+        static const int SINCE_LAST_REPORT = -2;
+        PrintPlanStatus(int planId, int since = FULL);
         void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
         PrintPlanStatus *clone() const override;
+        bool changesState() const override;
         const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
     private:
+        const string renderChanges(const Simulation &simulation) const;
         const int planId;
+        const int since; // A tick, FULL or SINCE_LAST_REPORT
 };
 
 
@@ -110,6 +139,7 @@ class ChangePlanPolicy : public BaseAction {
         ChangePlanPolicy(const int planId, const string &newPolicy);
         void act(Simulation &simulation) override;
         ChangePlanPolicy *clone() const override;
+        bool changesState() const override;
         const string toString() const override;
     private:
         const int planId;
@@ -121,9 +151,11 @@ class PrintActionsLog : public BaseAction {
     public:
         PrintActionsLog();
         void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
         PrintActionsLog *clone() const override;
         const string toString() const override;
-    private:
+    protected:
+        const string render(const StateReader &state) const override;
 };
 
 class Close : public BaseAction {
@@ -137,19 +169,229 @@ class Close : public BaseAction {
 
 class BackupSimulation : public BaseAction {
     public:
-        BackupSimulation();
+        BackupSimulation(const string &snapshotName);
         void act(Simulation &simulation) override;
         BackupSimulation *clone() const override;
         const string toString() const override;
     private:
+        const string snapshotName; // Empty for the default backup
 };
 
 
 class RestoreSimulation : public BaseAction {
     public:
-        RestoreSimulation();
+        RestoreSimulation(const string &snapshotName);
+        RestoreSimulation(const int targetTick);
         void act(Simulation &simulation) override;
         RestoreSimulation *clone() const override;
         const string toString() const override;
     private:
-};
\ No newline at end of file
+        const string snapshotName; // Empty for the default backup
+        const int targetTick; // -1 when restoring by name
+};
+
+
+class PrintSnapshots : public BaseAction {
+    public:
+        PrintSnapshots();
+        void act(Simulation &simulation) override;
+        PrintSnapshots *clone() const override;
+        const string toString() const override;
+    private:
+};
+
+
+class PolicySweep : public BaseAction {
+    public:
+        PolicySweep(const int numOfSteps);
+        void act(Simulation &simulation) override;
+        PolicySweep *clone() const override;
+        const string toString() const override;
+    private:
+        const int numOfSteps;
+};
+
+
+class SearchPolicySchedule : public BaseAction {
+    public:
+        SearchPolicySchedule(const int planId, const int numOfSteps, const int windowSize, const int lifeQualityWeight,
+                             const int economyWeight, const int environmentWeight, const int budgetMs);
+        void act(Simulation &simulation) override;
+        SearchPolicySchedule *clone() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+        const int numOfSteps;
+        const int windowSize;
+        const int lifeQualityWeight;
+        const int economyWeight;
+        const int environmentWeight;
+        const int budgetMs;
+};
+
+
+class ForkPlan : public BaseAction {
+    public:
+        ForkPlan(const int planId);
+        void act(Simulation &simulation) override;
+        ForkPlan *clone() const override;
+        bool changesState() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+};
+
+
+class StepFork : public BaseAction {
+    public:
+        StepFork(const int planId, const int numOfSteps);
+        void act(Simulation &simulation) override;
+        StepFork *clone() const override;
+        bool changesState() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+        const int numOfSteps;
+};
+
+
+class ChangeForkPolicy : public BaseAction {
+    public:
+        ChangeForkPolicy(const int planId, const string &newPolicy);
+        void act(Simulation &simulation) override;
+        ChangeForkPolicy *clone() const override;
+        bool changesState() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+        const string newPolicy;
+};
+
+
+class PrintForkStatus : public BaseAction {
+    public:
+        PrintForkStatus(const int planId);
+        void act(Simulation &simulation) override;
+        PrintForkStatus *clone() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+};
+
+
+class CommitFork : public BaseAction {
+    public:
+        CommitFork(const int planId);
+        void act(Simulation &simulation) override;
+        CommitFork *clone() const override;
+        bool changesState() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+};
+
+
+class DiscardFork : public BaseAction {
+    public:
+        DiscardFork(const int planId);
+        void act(Simulation &simulation) override;
+        DiscardFork *clone() const override;
+        bool changesState() const override;
+        const string toString() const override;
+    private:
+        const int planId;
+};
+
+
+class PrintTopPlans : public BaseAction {
+    public:
+        PrintTopPlans(const string &metric, const int k);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintTopPlans *clone() const override;
+        const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
+    private:
+        const string metric;
+        const int k;
+};
+
+
+class PrintAggregates : public BaseAction {
+    public:
+        PrintAggregates(const string &settlementName);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintAggregates *clone() const override;
+        const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
+    private:
+        const string settlementName; // Empty for the totals per settlement type and policy
+};
+
+
+class QueryPlans : public BaseAction {
+    public:
+        QueryPlans(const vector<string> &conditions);
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        QueryPlans *clone() const override;
+        const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
+    private:
+        PlanQuery parseQuery(const StateReader &state) const;
+        const vector<string> conditions; // "<field><op><value>", e.g. "policy=bal" or "economy>=5"
+};
+
+
+class PrintStats : public BaseAction {
+    public:
+        PrintStats();
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintStats *clone() const override;
+        const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
+};
+
+class PrintMemory : public BaseAction {
+    public:
+        PrintMemory();
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintMemory *clone() const override;
+        const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
+};
+
+class PrintScores : public BaseAction {
+    public:
+        PrintScores();
+        void act(Simulation &simulation) override;
+        bool isReadOnly() const override;
+        PrintScores *clone() const override;
+        const string toString() const override;
+    protected:
+        const string render(const StateReader &state) const override;
+};
+
+class PrintProgress : public BaseAction {
+    public:
+        PrintProgress();
+        void act(Simulation &simulation) override;
+        PrintProgress *clone() const override;
+        const string toString() const override;
+};
+
+class CancelRun : public BaseAction {
+    public:
+        CancelRun();
+        void act(Simulation &simulation) override;
+        CancelRun *clone() const override;
+        const string toString() const override;
+};
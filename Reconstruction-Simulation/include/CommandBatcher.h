@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class Simulation;
+
+// Runs a scripted workload from stdin in batches of up to maxLines lines, as many as
+// have arrived:
+//   simulation config_file.txt --batch 4096 < commands.txt
+// Within a batch, adjacent "step <n>" lines are stepped in one go, a run of
+// settlement/facility/plan lines reserves room for its settlements, plans and log
+// entries first (facility types go to the catalog, which grows in chunks), and output is
+// written in large blocks and flushed once per batch. The output and the log are the
+// same as running the lines one by one; only the timing of the output differs.
+class CommandBatcher {
+    public:
+        CommandBatcher(Simulation &simulation, size_t maxLines);
+        void run();
+
+    private:
+        void executeBatch(const vector<string> &lines);
+        void executeSteps(const vector<vector<string>> &args, size_t first, size_t last);
+        static bool isStep(const vector<string> &args);
+        static bool isInsertion(const vector<string> &args);
+
+        Simulation &simulation;
+        size_t maxLines;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CommandQueue.h"
+
+using std::atomic;
+using std::string;
+using std::thread;
+using std::vector;
+
+class Simulation;
+
+// Feeds the simulation from several producers at once, e.g. a replay file, an operator
+// console and a policy controller, each on its own input:
+//   simulation config_file.txt --input replay.txt --input console.fifo --input controller.sock
+// An input is a file, a FIFO, a Unix socket to connect to, or "-" for stdin. Each has a
+// reader thread that numbers its lines and pushes them onto a lock-free CommandQueue.
+// The thread that calls run() is the only executor: it drains the queue in batches.
+// Regular files are merged in (sequence, input) order - the first line of every file,
+// then the second, and so on - so their merge never depends on timing. Live inputs
+// (FIFOs, sockets, a terminal or pipe on stdin) may go quiet at any time, so their lines
+// run as they arrive, between the files' lines, and never hold the others back.
+class CommandInputs {
+    public:
+        explicit CommandInputs(const vector<string> &paths);
+        CommandInputs(const CommandInputs &other) = delete;
+        CommandInputs &operator=(const CommandInputs &other) = delete;
+        ~CommandInputs();
+        void run(Simulation &simulation);
+
+    private:
+        void read(int input);
+        void stop();
+
+        vector<int> fds;
+        vector<bool> live; // Per input: not a regular file, so it may go quiet
+        vector<thread> readers;
+        atomic<bool> stopping;
+        CommandQueue queue;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::atomic;
+using std::string;
+using std::vector;
+
+// A command line read by one producer. The sequence number counts that producer's
+// lines from 0; the last entry a producer pushes is its end marker.
+struct CommandEntry {
+    CommandEntry();
+    CommandEntry(int producer, uint64_t sequence, const string &line, bool end);
+    CommandEntry(const CommandEntry &other) = delete;
+    CommandEntry &operator=(const CommandEntry &other) = delete;
+    int producer;
+    uint64_t sequence;
+    string line;
+    bool end;
+    atomic<CommandEntry*> next; // Link inside the queue
+};
+
+// Multi-producer single-consumer queue of command lines. push() never takes a lock:
+// it swaps itself into the head and links the previous entry to it. Only the consumer
+// calls drain() and wait(); the lock in wait() is only taken while the queue is empty.
+class CommandQueue {
+    public:
+        CommandQueue();
+        CommandQueue(const CommandQueue &other) = delete;
+        CommandQueue &operator=(const CommandQueue &other) = delete;
+        ~CommandQueue();
+        void push(CommandEntry *entry);
+        size_t drain(vector<CommandEntry*> &batch);
+        void wait(int timeoutMs);
+
+    private:
+        CommandEntry *pop();
+        void link(CommandEntry *entry);
+
+        atomic<CommandEntry*> head; // Most recently pushed entry, swapped by producers
+        CommandEntry *tail; // Oldest entry, only touched by the consumer
+        CommandEntry stub; // Keeps the queue non-empty, so head and tail never need to be swapped together
+        atomic<bool> sleeping; // Whether the consumer is (about to be) blocked in wait()
+        std::mutex sleepLock;
+        std::condition_variable pushed;
+};
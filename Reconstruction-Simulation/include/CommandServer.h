@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::atomic;
+using std::condition_variable;
+using std::deque;
+using std::mutex;
+using std::string;
+using std::thread;
+using std::vector;
+
+class BaseAction;
+class Simulation;
+
+// Serves the command language to many clients over a Unix socket, e.g.
+//   socat - UNIX-CONNECT:<path>
+// Commands that change the simulation are queued to a single executor, the thread
+// that calls run(); the simulation publishes a StateView after each of them and
+// after every tick. Read-only commands are answered on the client's own thread from
+// the latest StateView without locks, so they never wait for a step in progress.
+class CommandServer {
+    public:
+        CommandServer(const string &socketPath);
+        CommandServer(const CommandServer &other) = delete;
+        CommandServer &operator=(const CommandServer &other) = delete;
+        ~CommandServer();
+        void run(Simulation &simulation);
+
+    private:
+        // A command for the executor. Waited-for requests belong to the client thread;
+        // log-only requests (already answered from a published view) are freed by the executor.
+        struct Request {
+            Request(BaseAction *action, const string &command, bool logOnly, uint64_t nanos);
+            Request(const Request &other) = delete;
+            Request &operator=(const Request &other) = delete;
+            BaseAction *action;
+            string command;
+            bool logOnly;
+            uint64_t nanos; // Time it took to answer a log-only request
+            string output;
+            bool done;
+        };
+
+        void acceptClients();
+        void serveClient(int client);
+        void reapClients();
+        const string handle(const string &line);
+        bool submit(Request *request);
+        void stop();
+
+        string socketPath;
+        int listenFd;
+        atomic<bool> stopping;
+
+        mutex queueLock; // Guards requests, closed and Request::done
+        condition_variable queued; // Wakes the executor
+        condition_variable finished; // Wakes clients waiting for their requests
+        deque<Request*> requests;
+        bool closed; // Set once the executor no longer takes requests
+
+        mutex clientsLock; // Guards clients and exited
+        vector<int> clients;
+        vector<thread::id> exited; // Client threads that ended and can be joined
+        vector<thread> clientThreads; // Only touched by the acceptor, and by stop() once it has ended
+        thread acceptor;
+};
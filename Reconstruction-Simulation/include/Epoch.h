@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Epoch-based reclamation for objects that readers use without taking locks.
+// A reader holds an EpochGuard while it uses a published object. A writer that
+// replaces an object retires the old one, and the old one is freed once every
+// reader that might still hold it has released its guard. Readers only
+// touch atomics; writers serialize among themselves with a mutex.
+class Epoch {
+    public:
+        static const int READERS_PER_BLOCK = 64; // The reader table grows by this many threads
+        static void retire(const void *object, void (*destroy)(const void*));
+        static void reclaim();
+        static size_t getRetiredCount();
+};
+
+// Marks the calling thread as a reader until destroyed. Guards may nest.
+class EpochGuard {
+    public:
+        EpochGuard();
+        EpochGuard(const EpochGuard &other) = delete;
+        EpochGuard &operator=(const EpochGuard &other) = delete;
+        ~EpochGuard();
+};
+
+// The latest version of an immutable object. get() may be called by any thread that
+// holds an EpochGuard; publish() takes ownership of the new version.
+template <class T>
+class Published {
+    public:
+        Published() : current(nullptr) {}
+        Published(const Published &other) = delete;
+        Published &operator=(const Published &other) = delete;
+        // Must only be destroyed once no reader can use it
+        ~Published() {
+            delete current.load();
+            Epoch::reclaim();
+        }
+
+        const T *get() const {
+            return current.load();
+        }
+
+        void publish(const T *next) {
+            const T *previous = current.exchange(next);
+            if (previous != nullptr) {
+                Epoch::retire(previous, &destroy);
+            }
+            Epoch::reclaim();
+        }
+
+    private:
+        static void destroy(const void *object) {
+            delete static_cast<const T*>(object);
+        }
+
+        std::atomic<const T*> current;
+};
@@ -6,6 +6,8 @@ using std::string;
 using std::vector;
 using namespace std;
 
+class Snapshot;
+
 
 enum class FacilityStatus {
     UNDER_CONSTRUCTIONS,
@@ -53,6 +55,7 @@ class Facility: public FacilityType {
         const string toString() const;
 
     private:
+        friend class Snapshot;
         const string settlementName;
         FacilityStatus status;
         int timeLeft;
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Facility.h"
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+// One version of the facility types: the first size() types of an append-only store.
+// The store keeps its types in chunks that never move (chunk k holds FIRST_CHUNK << k
+// types), so a version stays valid, and readable without locks, while later types are
+// appended, and an index into it (like a policy's last selection) keeps its meaning.
+// Stores are shared: simulations loaded with the same facilities get versions of one
+// store, and appending the type that the store already has next just moves to the
+// store's next version. Appending anything else to an older version copies that
+// version into a new store (copy-on-write); the other versions never change.
+class FacilityCatalog {
+    public:
+        class const_iterator {
+            public:
+                const_iterator(const FacilityCatalog &catalog, size_t index) : catalog(&catalog), index(index) {}
+                const FacilityType &operator*() const { return (*catalog)[index]; }
+                const_iterator &operator++() { ++index; return *this; }
+                bool operator!=(const const_iterator &other) const { return index != other.index; }
+
+            private:
+                const FacilityCatalog *catalog;
+                size_t index;
+        };
+
+        FacilityCatalog();
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        // Inline: policies index the catalog on every selection
+        const FacilityType &operator[](size_t index) const {
+            size_t chunk = chunkOf(index);
+            return storage->chunks[chunk][index - chunkStart(chunk)];
+        }
+        const_iterator begin() const;
+        const_iterator end() const;
+        bool contains(const string &name) const;
+        bool isSameVersion(const FacilityCatalog &other) const;
+        bool isSameStore(const FacilityCatalog &other) const;
+        uint64_t getStoreId() const;
+        void append(const FacilityType &type);
+
+        static FacilityCatalog intern(const vector<FacilityType> &types);
+
+    private:
+        static const size_t FIRST_CHUNK = 16; // A power of two
+        static const size_t MAX_CHUNKS = 40;
+
+        // Append-only storage shared by every version of it
+        struct Storage {
+            explicit Storage(uint64_t id);
+            Storage(const Storage &other) = delete;
+            Storage &operator=(const Storage &other) = delete;
+            ~Storage();
+            void push(const FacilityType &type);
+
+            FacilityType *chunks[MAX_CHUNKS]; // Allocated as needed, never moved
+            size_t count; // Types pushed so far; changed only under the registry lock
+            const uint64_t id;
+        };
+
+        FacilityCatalog(const shared_ptr<Storage> &storage, size_t count);
+
+        static size_t chunkOf(size_t index) {
+            return 63 - __builtin_clzll(index / FIRST_CHUNK + 1);
+        }
+        static size_t chunkStart(size_t chunk) {
+            return FIRST_CHUNK * ((size_t(1) << chunk) - 1);
+        }
+        static FacilityCatalog find(const vector<FacilityType> &types);
+        static FacilityCatalog create(const vector<FacilityType> &types);
+        static bool sameType(const FacilityType &a, const FacilityType &b);
+
+        shared_ptr<Storage> storage; // Null for the empty catalog
+        size_t count;
+};
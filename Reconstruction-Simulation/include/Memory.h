@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+using std::string;
+
+class Facility;
+class SelectionPolicy;
+
+// Subsystems that live heap memory is accounted to
+enum class MemoryTag {
+    OTHER,
+    PLANS,
+    FACILITIES_UNDER_CONSTRUCTION,
+    FACILITIES_OPERATIONAL,
+    SETTLEMENTS,
+    FACILITY_TYPES,
+    POLICIES,
+    ACTIONS_LOG,
+    SNAPSHOTS,
+};
+
+// Allocator-level memory accounting. Every block from operator new carries a
+// small header with its size and tag, so live bytes and blocks per subsystem
+// are exact. A block gets the tag of the innermost MemoryScope on its thread
+// when it is allocated, and can be moved to another tag with retag().
+// Each thread counts into its own counters without atomic read-modify-writes;
+// readers sum the counters of all threads.
+class Memory {
+    public:
+        static const int NUM_OF_TAGS = 9;
+        // Only for objects from a plain new, as plans own theirs
+        static void retag(const Facility *facility, MemoryTag tag);
+        static void retag(const SelectionPolicy *policy, MemoryTag tag);
+        static uint64_t getBytes(MemoryTag tag);
+        static uint64_t getBlocks(MemoryTag tag);
+        static uint64_t getAllocations();
+        static uint64_t getAllocatedBytes();
+        static const char *tagName(MemoryTag tag);
+        static const string toString();
+};
+
+// Tags the allocations made by this thread while the scope is alive
+class MemoryScope {
+    public:
+        MemoryScope(MemoryTag tag);
+        MemoryScope(const MemoryScope &other) = delete;
+        MemoryScope &operator=(const MemoryScope &other) = delete;
+        ~MemoryScope();
+
+    private:
+        MemoryTag previous;
+};
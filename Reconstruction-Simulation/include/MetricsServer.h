@@ -0,0 +1,33 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <thread>
+
+using std::atomic;
+using std::string;
+using std::thread;
+
+class Simulation;
+
+// Serves Prometheus text-format metrics over HTTP on a Unix socket, e.g.
+//   curl --unix-socket <path> http://localhost/metrics
+// A background thread answers scrapes from atomic counters only: the command
+// loop publishes the simulation's gauges after each command and never waits.
+class MetricsServer {
+    public:
+        MetricsServer(const string &socketPath);
+        MetricsServer(const MetricsServer &other) = delete;
+        MetricsServer &operator=(const MetricsServer &other) = delete;
+        ~MetricsServer();
+        static void publish(const Simulation &simulation);
+        static const string render();
+
+    private:
+        void run();
+        void serve(int client) const;
+
+        string socketPath;
+        int listenFd;
+        atomic<bool> stopping;
+        thread worker;
+};
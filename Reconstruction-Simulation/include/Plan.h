@@ -10,40 +10,91 @@
 using namespace std;
 using std::vector;
 
+class Snapshot;
+
 enum class PlanStatus {
     AVALIABLE,
     BUSY,
 };
 
+// One entry of a plan's change log
+struct PlanChange {
+    enum Kind { FACILITY_STARTED, FACILITY_COMPLETED, SCORES, STATUS, POLICY };
+    PlanChange(int tick, Kind kind, const string &detail) : tick(tick), kind(kind), detail(detail) {}
+    int tick; // Simulation tick at which the change became visible
+    Kind kind;
+    string detail; // Facility name, "<life> <economy> <environment>", status or policy name
+};
+
+// What one step did to a plan; only the simulation's own steps add it to the process-wide counters
+struct PlanStepCounts {
+    size_t started;
+    size_t completed;
+};
+
 class Plan {
     public:
-        Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions);
+        Plan(const int planId, const size_t settlementId, const vector<Settlement*> &settlements, SelectionPolicy *selectionPolicy, const FacilityCatalog &facilityOptions);
         Plan(const Plan &other);             
+        Plan(const Plan &other, const vector<Settlement*> &settlements, const FacilityCatalog &facilityOptions);
         Plan &operator=(const Plan &other) = delete;  
         Plan(Plan &&other) noexcept;
         Plan &operator=(Plan &&other) noexcept = delete;
         ~Plan();
+        void swap(Plan &other) noexcept;
+        void adopt(Plan &fork);
         const Settlement& getSettlement() const;
+        size_t getSettlementId() const;
+        void bindTables(const vector<Settlement*> &settlements, const FacilityCatalog &facilityOptions);
         const int getPlanId() const;
         const int getlifeQualityScore() const;
         const int getEconomyScore() const;
         const int getEnvironmentScore() const;
+        PlanStatus getStatus() const;
         SelectionPolicy* getSelectionPolicy() const; 
         const vector<Facility*> &getFacilities() const;
         const vector<Facility *> &getFacilitiesUnderConstruction() const;
         void setSelectionPolicy(SelectionPolicy *selectionPolicy);
-        void step();
+        SelectionPolicy *createPolicy(const string &policyName) const;
+        PlanStepCounts step();
         void addFacility(Facility* facility);
         void printStatus();
         const string toString() const;
+        size_t hashState() const;
+        bool isSameState(const Plan &other) const;
+        size_t getRevision() const;
+
+        // Change log: copies start an empty log at the source's tick
+        static const size_t NOT_REPORTED = static_cast<size_t>(-1);
+        static const size_t MAX_CHANGES = 1024; // The oldest changes are dropped beyond this
+        void startChangeLog(int tick);
+        void setTick(int tick);
+        int getTick() const;
+        int getLogStart() const;
+        size_t findChanges(int since) const;
+        const string changesToString(size_t from) const;
+        size_t getReported() const;
+        void markReported();
 
     private:
+        friend class Snapshot;
         int plan_id;
-        const Settlement &settlement;
+        size_t settlementId; // Handle into the owning simulation's settlement table
+        const vector<Settlement*> *settlements;
         SelectionPolicy *selectionPolicy; //What happens if we change this to a reference?
         PlanStatus status;
         vector<Facility*> facilities;
         vector<Facility*> underConstruction;
-        const vector<FacilityType> &facilityOptions;
+        const FacilityCatalog *facilityOptions;
         int life_quality_score, economy_score, environment_score;
+        int tick;                  // Tick that new changes are tagged with: the one after the last step
+        int logStart;              // Tick the change log starts at; older changes are unknown
+        vector<PlanChange> changes;
+        size_t reported;           // Changes already sent to the subscriber, or NOT_REPORTED
+        size_t revision;           // Bumped on every change, so published views can tell which plans changed
+        // toString() output for facilities[0, renderedCount); operational facilities are only ever appended
+        mutable string renderedFacilities;
+        mutable size_t renderedCount;
+        void recordChange(PlanChange::Kind kind, const string &detail);
+        void trimChanges();
 };
\ No newline at end of file
@@ -0,0 +1,102 @@
+#pragma once
+#include "Plan.h"
+#include <climits>
+#include <deque>
+#include <functional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::deque;
+using std::function;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+enum class ScoreMetric {
+    LIFE_QUALITY,
+    ECONOMY,
+    ENVIRONMENT,
+};
+
+// Conditions of a "plans where ..." query; -1 means "any"
+struct PlanQuery {
+    PlanQuery() : settlementId(-1), settlementType(-1), policy(-1), status(-1),
+                  minScores{INT_MIN, INT_MIN, INT_MIN}, maxScores{INT_MAX, INT_MAX, INT_MAX} {}
+    long settlementId;
+    int settlementType;
+    int policy;
+    int status;
+    int minScores[3]; // Inclusive bounds per ScoreMetric
+    int maxScores[3];
+};
+
+// Rankings, totals and secondary indexes over all plans, kept up to date as plans change instead of
+// being recomputed by scanning every plan. The simulation reports each change:
+// new plans, score and status changes after a step, and policy changes.
+class PlanViews {
+    public:
+        PlanViews();
+        void addPlan(const Plan &plan);
+        void updateState(const Plan &plan);
+        void updatePolicy(const Plan &plan);
+        void rebuild(const deque<Plan> &plans);
+        void reserve(size_t plans);
+        vector<pair<int, int>> top(ScoreMetric metric, size_t k) const;
+        size_t getSettlementId(int planId) const;
+        size_t getOperationalFacilities() const;
+        size_t getFacilitiesUnderConstruction() const;
+        const string planToString(int planId) const;
+        const string toString() const;
+        const string settlementToString(size_t settlementId) const;
+        size_t query(const PlanQuery &query, const function<void(int)> &visit) const;
+        static bool parseMetric(const string &name, ScoreMetric &metric);
+        static int parsePolicy(const string &name);
+
+    private:
+        static const int NUM_OF_METRICS = 3;
+        static const int NUM_OF_POLICIES = 4;
+        static const int NUM_OF_TYPES = 3;
+
+        struct PlanEntry {
+            PlanEntry() : settlementId(0), settlementType(0), policy(0), status(0), scores{0, 0, 0}, operational(0),
+                          underConstruction(0) {}
+            size_t settlementId;
+            int settlementType;
+            int policy;
+            int status;
+            int scores[NUM_OF_METRICS];
+            size_t operational; // Facility counts, summed over all plans for the metrics
+            size_t underConstruction;
+        };
+
+        struct Totals {
+            Totals() : plans(0), scores{0, 0, 0} {}
+            long plans;
+            long scores[NUM_OF_METRICS];
+        };
+
+        static const int NUM_OF_STATUSES = 2;
+
+        static int policyIndex(const Plan &plan);
+        void account(int planId, int sign);
+        void countFacilities(PlanEntry &entry, const Plan &plan);
+        bool matches(int planId, const PlanQuery &query) const;
+        const string totalsToString(const Totals &totals) const;
+
+        vector<PlanEntry> entries; // Indexed by plan id
+        set<pair<int, int>> ranked[NUM_OF_METRICS]; // (score, -planId), so ties list lower ids first
+        vector<Totals> bySettlement; // Indexed by settlement id
+        Totals byType[NUM_OF_TYPES];
+        Totals byPolicy[NUM_OF_POLICIES];
+        size_t operationalFacilities;
+        size_t facilitiesUnderConstruction;
+
+        // Secondary indexes: plan ids by attribute
+        vector<vector<int>> plansBySettlement; // A plan never changes settlement
+        vector<int> plansByType[NUM_OF_TYPES];
+        set<int> plansByPolicy[NUM_OF_POLICIES];
+        set<int> plansByStatus[NUM_OF_STATUSES];
+};
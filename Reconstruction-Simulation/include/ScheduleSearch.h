@@ -0,0 +1,56 @@
+#pragma once
+#include "Plan.h"
+#include "ThreadPool.h"
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Searches for the policy switching schedule that maximizes a plan's weighted score.
+// The horizon is split into windows of equal length and a policy is picked for each
+// one by beam search: every surviving state is copied once per policy, the copies are
+// stepped through the window in parallel, equal states are merged, and the
+// best BEAM_WIDTH states carry on. Only the plan is copied, never the whole simulation.
+class ScheduleSearch {
+    public:
+        ScheduleSearch(const Plan &plan, const int numOfSteps, const int windowSize,
+                       const int lifeQualityWeight, const int economyWeight, const int environmentWeight);
+        ScheduleSearch(const ScheduleSearch &other) = delete;
+        ScheduleSearch &operator=(const ScheduleSearch &other) = delete;
+        ~ScheduleSearch();
+        void run(const int budgetMs, ThreadPool &pool);
+        const vector<string> &getSchedule() const;
+        const Plan &getResult() const;
+        long getWeightedScore() const;
+        int getWindowSize() const;
+        size_t getStatesExplored() const;
+        size_t getStatesMerged() const;
+        bool isFinished() const;
+
+    private:
+        // Copies share the plan; ScheduleSearch decides which state frees it
+        struct State {
+            State() : plan(nullptr), schedule(), weightedScore(0) {}
+            State(const State &other) = default;
+            State &operator=(const State &other) = default;
+            Plan *plan;
+            vector<string> schedule; // One policy per window
+            long weightedScore;
+        };
+
+        static const size_t BEAM_WIDTH = 32;
+
+        long weigh(const Plan &plan) const;
+
+        const Plan &origin;
+        const int numOfSteps;
+        const int windowSize;
+        const int lifeQualityWeight;
+        const int economyWeight;
+        const int environmentWeight;
+        State best;
+        size_t statesExplored;
+        size_t statesMerged;
+        bool finished; // False when the time budget ran out before the last window
+};
@@ -1,41 +1,57 @@
 #pragma once
 #include <vector>
 #include "Facility.h"
+#include "FacilityCatalog.h"
+#include "Stats.h"
 #include <algorithm>
 #include <climits>
 #include <stdexcept> 
 #include <iostream>
 #include <fstream>
+#include <functional>
 
 using namespace std;
 using std::vector;
 
+class Snapshot;
+
 class SelectionPolicy {
     public:
-        virtual const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) = 0;
+        virtual const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions) = 0;
         virtual const string toString() const = 0;
         virtual SelectionPolicy* clone() const = 0;
+        virtual size_t hashState() const = 0;
+        virtual bool isSameState(const SelectionPolicy &other) const = 0; // Same selections from now on
+        virtual Stats::Counter getSelectionCounter() const = 0; // Counts this policy's selections
         virtual ~SelectionPolicy() = default;
 };
 
 class NaiveSelection: public SelectionPolicy {
     public:
         NaiveSelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions) override;
         const string toString() const override;
         NaiveSelection *clone() const override;
+        size_t hashState() const override;
+        bool isSameState(const SelectionPolicy &other) const override;
+        Stats::Counter getSelectionCounter() const override;
         ~NaiveSelection() override = default;
     private:
+        friend class Snapshot;
         int lastSelectedIndex;
 };
 
 class BalancedSelection: public SelectionPolicy {
     public:
         BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore);
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions) override;
         const string toString() const override;
         BalancedSelection *clone() const override;
+        size_t hashState() const override;
+        bool isSameState(const SelectionPolicy &other) const override;
+        Stats::Counter getSelectionCounter() const override;
     private:
+        friend class Snapshot;
         int LifeQualityScore;
         int EconomyScore;
         int EnvironmentScore;
@@ -44,11 +60,15 @@ class BalancedSelection: public SelectionPolicy {
 class EconomySelection: public SelectionPolicy {
     public:
         EconomySelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions) override;
         const string toString() const override;
         EconomySelection *clone() const override;
+        size_t hashState() const override;
+        bool isSameState(const SelectionPolicy &other) const override;
+        Stats::Counter getSelectionCounter() const override;
         ~EconomySelection() override = default;
     private:
+        friend class Snapshot;
         int lastSelectedIndex;
 
 };
@@ -56,10 +76,14 @@ class EconomySelection: public SelectionPolicy {
 class SustainabilitySelection: public SelectionPolicy {
     public:
         SustainabilitySelection();
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions) override;
         const string toString() const override;
         SustainabilitySelection *clone() const override;
+        size_t hashState() const override;
+        bool isSameState(const SelectionPolicy &other) const override;
+        Stats::Counter getSelectionCounter() const override;
         ~SustainabilitySelection() override = default;
     private:
+        friend class Snapshot;
         int lastSelectedIndex;
 };
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+using std::map;
+using std::string;
+using std::vector;
+
+class Simulation;
+
+// Splits the plans across worker processes on the same machine:
+//   simulation config_file.txt --shards 4 < commands.txt
+// Each worker is forked from the loaded simulation, so it starts with the whole catalog
+// and keeps the plans whose id modulo the shard count is its index. The coordinator
+// reads stdin and routes each command: settlement, facility, plan and step go to every
+// worker (step is a barrier: the next command waits for all of them), plan commands go
+// to the plan's owner, and log and close are answered by the coordinator; backup and
+// restore by name go to every worker, each keeping its own snapshots. After every
+// command a worker writes its plans' scores and statuses to its partition of a shared
+// memory region, which close reads to print every plan in id order, as a single
+// process would. Commands that need every plan at once (restore --step, snapshots,
+// sweeps, queries, stats, background steps) are not available.
+class ShardedRunner {
+    public:
+        ShardedRunner(Simulation &simulation, int shardCount);
+        ShardedRunner(const ShardedRunner &other) = delete;
+        ShardedRunner &operator=(const ShardedRunner &other) = delete;
+        ~ShardedRunner();
+        void run();
+
+    private:
+        // One plan's results, as a worker last published them
+        struct PlanSlot {
+            int planId;
+            int status;
+            int lifeQualityScore;
+            int economyScore;
+            int environmentScore;
+            int underConstruction;
+        };
+
+        // A worker's partition of the shared region
+        struct Partition {
+            size_t count;
+            PlanSlot slots[1]; // count of them, up to MAX_PLANS_PER_SHARD
+        };
+
+        // What the coordinator restores along with the workers' snapshots
+        struct Backup {
+            vector<string> actionsLog;
+            vector<string> settlementNames;
+        };
+
+        struct Worker {
+            pid_t pid;
+            int commands; // Coordinator -> worker: one command line at a time
+            int replies; // Worker -> coordinator: the logged action and the command's output
+        };
+
+        static const size_t MAX_PLANS_PER_SHARD = 1 << 20;
+
+        void startWorkers();
+        void serve(int shard, int commands, int replies);
+        void publish(int shard) const;
+        Partition &partition(int shard) const;
+        bool dispatch(const string &line);
+        const string send(const vector<int> &shards, const string &line, int replyFrom);
+        static bool isCompleted(const string &logged);
+        void close();
+        void stopWorkers();
+
+        Simulation &simulation;
+        int shardCount;
+        vector<int> everyShard;
+        size_t partitionSize;
+        char *region; // Shared with the workers
+        vector<Worker> workers;
+        vector<string> settlementNames; // Indexed by plan id
+        vector<string> actionsLog; // Every logged action, as the owning worker described it
+        map<string, Backup> backups; // By snapshot name ("" for the default backup)
+};
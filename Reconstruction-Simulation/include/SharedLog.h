@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+
+using std::shared_ptr;
+using std::string;
+
+// The action log as readers on other threads see it: the first size() lines of an
+// append-only store. Like FacilityCatalog, the store keeps its lines in chunks that
+// never move (chunk k holds FIRST_CHUNK << k lines), so a version stays readable
+// without locks while its single writer appends to the newest one. Copies of a
+// version share the store; a log that is replaced rather than appended to starts
+// a new store.
+class SharedLog {
+    public:
+        SharedLog();
+        size_t size() const { return count; }
+        const string &operator[](size_t index) const {
+            size_t chunk = chunkOf(index);
+            return storage->chunks[chunk][index - chunkStart(chunk)];
+        }
+        void append(const string &line);
+
+    private:
+        static const size_t FIRST_CHUNK = 64; // A power of two
+        static const size_t MAX_CHUNKS = 40;
+
+        // Append-only storage shared by every version of it
+        struct Storage {
+            Storage();
+            Storage(const Storage &other) = delete;
+            Storage &operator=(const Storage &other) = delete;
+            ~Storage();
+
+            string *chunks[MAX_CHUNKS]; // Allocated as needed, never moved
+            size_t count; // Lines appended so far; only the writer reads it
+        };
+
+        static size_t chunkOf(size_t index) {
+            return 63 - __builtin_clzll(index / FIRST_CHUNK + 1);
+        }
+        static size_t chunkStart(size_t chunk) {
+            return FIRST_CHUNK * ((size_t(1) << chunk) - 1);
+        }
+
+        shared_ptr<Storage> storage; // Null until the first line
+        size_t count;
+};
@@ -6,21 +6,29 @@
 #include "SelectionPolicy.h"
 #include "Settlement.h"
 #include "Auxiliary.h"
+#include "PlanViews.h"
+#include "FacilityCatalog.h"
+#include "StateView.h"
 #include <unistd.h>
 
 #include <algorithm>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
 
 using namespace std;
 using std::string;
 using std::vector;
 
 class BaseAction;
+class Snapshot;
+class StepRunner;
+class Telemetry;
 
 
-class Simulation {
+class Simulation : public StateReader {
     public:
         Simulation(const string &configFilePath);
         Simulation(const Simulation &other);              
@@ -29,26 +37,72 @@ class Simulation {
         Simulation &operator=(Simulation &&other) noexcept;
         ~Simulation(); 
         void start();
-        void addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy);
+        void execute(BaseAction *action, const string &command);
+        void record(BaseAction *action, const string &command, uint64_t nanos);
+        const BaseAction *executeLine(const string &line);
+        static BaseAction *parseAction(const vector<string> &args);
+        void addPlan(const size_t settlementId, SelectionPolicy *selectionPolicy);
         void addAction(BaseAction *action);
+        void reserve(size_t settlementCount, size_t planCount, size_t actionCount);
         bool addSettlement(Settlement *settlement);
         bool addFacility(FacilityType facility);
-        bool isSettlementExists(const string &settlementName);
+        bool isSettlementExists(const string &settlementName) const override;
         bool isFacilityExists(const string &facilityName);
-        bool isPlanExists(const int planId);
+        bool isPlanExists(const int planId) const override;
         Settlement &getSettlement(const string &settlementName);
+        size_t getSettlementId(const string &settlementName) const override;
+        const string &getSettlementName(size_t settlementId) const override;
         Plan &getPlan(const int planID);
+        const Plan &getPlan(const int planID) const;
+        const deque<Plan> &getPlans() const;
+        const string getPlanDetails(const int planId) const override;
+        bool isForked(const int planId) const;
+        Plan &forkPlan(const int planId);
+        Plan &getFork(const int planId);
+        void commitFork(const int planId);
+        void discardFork(const int planId);
+        void changePlanPolicy(const int planId, SelectionPolicy *selectionPolicy);
+        const PlanViews &getViews() const override;
         const std::vector<BaseAction*>& getActionsLog() const;
+        size_t getLogSize() const override;
+        const string getLogLine(size_t index) const override;
+        int getTick() const override;
+        uint64_t getGeneration() const;
+        size_t getSettlementCount() const;
+        size_t getFacilityTypeCount() const;
+        const FacilityCatalog &getCatalog() const;
         void step();
         void close();
         void open();
+        bool isOpen() const;
+        void setPublishing(bool enabled);
+        void setTelemetry(Telemetry *telemetry);
+        void runAsync(const int numOfSteps);
+        StepRunner *getRunner() const;
+        void keepShard(int shard, int shardCount);
         
 
     private:
+        friend class Snapshot;
+        void clear();
+        void bindPlans();
+        void publishCatalog();
+
         bool isRunning;
+        bool publishing; // Whether steps and commands publish a StateView; never copied
+        StepRunner *runner; // Background run of "step --async"; only the simulation built from the config has one
+        Telemetry *telemetry; // Samples this simulation's steps when set; never copied
+        int shard; // Plans this simulation owns: ids equal to shard modulo shardCount
+        int shardCount;
         int planCounter; 
+        int tick; // Number of steps simulated so far
+        uint64_t generation; // Bumped when clear() drops the plans, tables and log, so published views start over
         vector<BaseAction*> actionsLog;
-        vector<Plan> plans;
+        deque<Plan> plans; // Chunked storage: appending never relocates existing plans
         vector<Settlement*> settlements;
-        vector<FacilityType> facilitiesOptions;
+        unordered_map<string, size_t> settlementIds; // Settlement name -> index in settlements
+        FacilityCatalog catalog; // Newest version: facilities are added here. Shared with copies and with other simulations that have the same types
+        FacilityCatalog visibleCatalog; // The version plans select from; catches up with catalog between commands and steps
+        unordered_map<int, Plan*> forks; // Plan id -> what-if copy of that plan
+        PlanViews views; // Rankings and totals, updated on every plan change
 };
\ No newline at end of file
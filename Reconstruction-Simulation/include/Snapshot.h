@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+using std::string;
+using std::vector;
+
+class Simulation;
+
+// A relocatable image of a simulation's state, held in one contiguous buffer.
+// Records refer to each other by table index and to strings by offset into a
+// string pool, so the image contains no pointers: copying a snapshot is a single
+// memcpy and the buffer can be moved, shared or written out as-is.
+class Snapshot {
+    public:
+        Snapshot(const Simulation &simulation);
+        Snapshot(const vector<char> &image);
+        void restore(Simulation &simulation) const;
+        const vector<char> &getImage() const;
+        size_t size() const;
+
+    private:
+        vector<char> image;
+};
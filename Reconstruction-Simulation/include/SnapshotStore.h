@@ -0,0 +1,51 @@
+#pragma once
+#include "Snapshot.h"
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+class Simulation;
+class BaseAction;
+
+// Keeps a history of named snapshots. Each snapshot is stored as a delta
+// against the one taken before it, with a full keyframe every
+// KEYFRAME_INTERVAL snapshots, so memory grows with the amount of change
+// rather than with the number of snapshots. Reusing a name replaces the old
+// snapshot, so the store holds one snapshot per name.
+class SnapshotStore {
+    public:
+        SnapshotStore();
+        void save(const string &name, const Simulation &simulation);
+        bool contains(const string &name) const;
+        void restore(const string &name, Simulation &simulation) const;
+        void restoreToTick(int tick, Simulation &simulation) const;
+        size_t getStoredBytes() const;
+        const string toString() const;
+
+    private:
+        struct Entry {
+            string name;
+            int tick;
+            size_t logCount; // Length of the simulation's log when it was taken
+            size_t logHash; // Hash of that log, to tell whether it is part of another history
+            bool keyframe;
+            size_t imageSize;
+            vector<char> data; // Full image for keyframes, delta against the previous entry otherwise
+        };
+
+        static const size_t KEYFRAME_INTERVAL = 16;
+
+        Snapshot decode(size_t index) const;
+        int find(const string &name) const;
+        void drop(size_t index);
+        static void replay(const vector<BaseAction*> &actions, int tick, Simulation &simulation);
+        static size_t hashLine(size_t hash, const string &line);
+        static vector<char> encodeDelta(const vector<char> &base, const vector<char> &target);
+        static vector<char> applyDelta(const vector<char> &base, const vector<char> &delta);
+
+        vector<Entry> entries;
+        vector<char> lastImage; // Image of the newest entry, the base for the next delta
+        size_t sinceKeyframe;
+};
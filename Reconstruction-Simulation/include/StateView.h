@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Plan.h"
+#include "PlanViews.h"
+#include "SharedLog.h"
+
+using std::shared_ptr;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+class Simulation;
+
+// What read-only commands read: the simulation itself on its own thread, or the
+// latest StateView it published, on any other thread
+class StateReader {
+    public:
+        virtual ~StateReader() = default;
+        virtual int getTick() const = 0;
+        virtual bool isPlanExists(const int planId) const = 0;
+        virtual const string getPlanDetails(const int planId) const = 0;
+        virtual const PlanViews &getViews() const = 0;
+        virtual bool isSettlementExists(const string &settlementName) const = 0;
+        virtual size_t getSettlementId(const string &settlementName) const = 0;
+        virtual const string &getSettlementName(size_t settlementId) const = 0;
+        virtual size_t getLogSize() const = 0;
+        virtual const string getLogLine(size_t index) const = 0;
+};
+
+// One plan's status and scores at a tick
+struct PlanState {
+    int planId;
+    string settlementName;
+    PlanStatus status;
+    string policy;
+    int lifeQualityScore;
+    int economyScore;
+    int environmentScore;
+    size_t operational;
+    size_t underConstruction;
+    size_t revision; // The plan's revision these were taken at
+    shared_ptr<const string> details; // What planStatus prints; refreshed after commands only
+    size_t detailsRevision;
+};
+
+// Immutable view of the simulation for readers on other threads. The simulation publishes
+// a new one after each step and each command (see Simulation::setPublishing); readers on
+// any thread use latest() inside an EpochGuard, without locks, even during a long step.
+// A view is built from the previous one: plans whose revision did not change, the
+// settlement names and the log are shared with it, and new log lines are appended to its
+// store, so publishing costs little more than the plans that changed. After a step only
+// the statuses and scores are refreshed; plan details, rankings and the log catch up
+// when the command ends.
+class StateView : public StateReader {
+    public:
+        explicit StateView(const Simulation &simulation);
+        int getTick() const override;
+        bool isPlanExists(const int planId) const override;
+        const string getPlanDetails(const int planId) const override;
+        const PlanViews &getViews() const override;
+        bool isSettlementExists(const string &settlementName) const override;
+        size_t getSettlementId(const string &settlementName) const override;
+        const string &getSettlementName(size_t settlementId) const override;
+        size_t getLogSize() const override;
+        const string getLogLine(size_t index) const override;
+        const vector<shared_ptr<const PlanState>> &getPlans() const;
+        const string toString() const;
+
+        static void publish(const Simulation &simulation);
+        static void publishTick(const Simulation &simulation);
+        static const StateView *latest();
+
+    private:
+        struct Settlements {
+            Settlements() : names(), ids() {}
+            vector<string> names;
+            unordered_map<string, size_t> ids;
+        };
+
+        StateView(const Simulation &simulation, const StateView *previous, bool commandDone);
+
+        int tick;
+        uint64_t generation; // The simulation's generation; a view of another one shares nothing
+        vector<shared_ptr<const PlanState>> plans; // Indexed by plan id; null for ids without a plan
+        shared_ptr<const PlanViews> views;
+        bool viewsStale; // Plans changed since views was copied
+        shared_ptr<const Settlements> settlements;
+        SharedLog log;
+};
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+using std::atomic;
+using std::function;
+using std::string;
+
+// Latency histogram with power-of-two nanosecond buckets. Safe to record
+// from several threads; percentiles are reported as bucket upper bounds.
+class LatencyHistogram {
+    public:
+        LatencyHistogram();
+        LatencyHistogram(const LatencyHistogram &other) = delete;
+        LatencyHistogram &operator=(const LatencyHistogram &other) = delete;
+        void record(uint64_t nanos);
+        uint64_t getCount() const;
+        uint64_t getSum() const;
+        uint64_t getMax() const;
+        uint64_t getBucket(int bucket) const;
+        uint64_t percentile(double fraction) const;
+        const string toString() const;
+
+        static const int NUM_OF_BUCKETS = 64;
+        static uint64_t bucketLimit(int bucket);
+
+    private:
+        atomic<uint64_t> buckets[NUM_OF_BUCKETS];
+        atomic<uint64_t> count;
+        atomic<uint64_t> sum;
+        atomic<uint64_t> max;
+};
+
+// Process-wide instrumentation: event counters, step and per-command latencies.
+// Counters are relaxed atomics, so recording is cheap enough to stay always on,
+// and other threads (the metrics server) can read everything without locking.
+class Stats {
+    public:
+        enum Counter {
+            STEPS,
+            FACILITIES_STARTED,
+            FACILITIES_COMPLETED,
+            SELECTIONS_NAIVE,
+            SELECTIONS_BALANCED,
+            SELECTIONS_ECONOMY,
+            SELECTIONS_SUSTAINABILITY,
+            PARSE_ERRORS,
+            SNAPSHOTS,
+            SNAPSHOT_IMAGE_BYTES,
+            SNAPSHOT_STORED_BYTES,
+            NUM_OF_COUNTERS
+        };
+
+        // Errors and latencies of one command
+        struct CommandStats {
+            CommandStats() : name(), errors(0), latency() {}
+            string name; // Written once, before the entry is published
+            atomic<uint64_t> errors;
+            LatencyHistogram latency;
+        };
+        static const size_t MAX_COMMANDS = 64;
+
+        static void add(Counter counter, uint64_t amount = 1);
+        static uint64_t get(Counter counter);
+        static void recordStep(uint64_t nanos);
+        static void recordCommand(const string &command, uint64_t nanos, bool failed);
+        static const LatencyHistogram &getStepLatency();
+        static void forEachCommand(const function<void(const CommandStats&)> &visit);
+        static uint64_t now();
+        static const string toString();
+};
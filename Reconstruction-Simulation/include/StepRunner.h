@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+using std::atomic;
+using std::condition_variable;
+using std::mutex;
+using std::string;
+using std::thread;
+
+class Simulation;
+
+// Runs "step <n> --async" on a background thread, one tick at a time. Every command
+// pauses the run with a RunPause, which waits for the tick in progress to finish, so
+// commands never see a half-stepped simulation and the run resumes once they are done.
+class StepRunner {
+    public:
+        explicit StepRunner(Simulation &simulation);
+        StepRunner(const StepRunner &other) = delete;
+        StepRunner &operator=(const StepRunner &other) = delete;
+        ~StepRunner();
+        void start(int numOfSteps);
+        int cancel();
+        bool isActive() const;
+        const string progress() const;
+
+    private:
+        friend class RunPause;
+        enum class RunState { IDLE, RUNNING, FINISHED, CANCELLED };
+
+        void run(int numOfSteps);
+        void pause();
+        void resume();
+
+        Simulation &simulation;
+        mutex lock; // Held by the worker for a whole tick; guards pauses
+        condition_variable resumed;
+        int pauses;
+        atomic<int> pauseRequests; // Commands waiting for the tick in progress
+        atomic<bool> cancelling;
+        atomic<RunState> state;
+        atomic<int> ticksDone;
+        int ticksRequested;
+        uint64_t startNanos;
+        atomic<uint64_t> endNanos;
+        thread worker;
+};
+
+// Keeps a background run (if any) between ticks until destroyed
+class RunPause {
+    public:
+        explicit RunPause(const Simulation &simulation);
+        RunPause(const RunPause &other) = delete;
+        RunPause &operator=(const RunPause &other) = delete;
+        ~RunPause();
+
+    private:
+        StepRunner *runner;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using std::condition_variable;
+using std::mutex;
+using std::ofstream;
+using std::string;
+using std::thread;
+using std::vector;
+
+class Simulation;
+
+// Opt-in record of every plan's trajectory, for post-processing:
+//   simulation config_file.txt --telemetry scores.bin --telemetry-every 10
+// Every K ticks, step() copies each plan's id, status, three scores and number of
+// facilities under construction into the filling buffer. Once a block's worth is
+// there the buffers are swapped and a background thread encodes and writes the full
+// one, so stepping never waits for the disk. If the writer is still busy, the filling
+// buffer just keeps growing until it is free.
+//
+// File layout (integers are little-endian; "varint" is LEB128, "signed" is zigzag then varint):
+//   header:  "RSTM", u32 format version, u32 K
+//   blocks:  varint samples, varint rows, then one column after another, each
+//            prefixed by its varint byte length so readers can skip it:
+//            tick (signed delta from the previous sample; the first is absolute),
+//            plan count per sample (varint),
+//            plan id, status, life quality, economy, environment, under construction
+//            (signed delta from the same row of the previous sample, or from 0 for
+//            rows the previous sample did not have and for the block's first sample)
+//   index:   per block: i64 lowest tick, i64 highest tick, u64 offset, u64 length
+//   trailer: u64 index offset, u64 block count, "RSTI"
+// A reader seeks to the trailer, loads the index and decodes only the blocks that
+// cover the ticks it wants. Ticks only go back after a restore, so blocks are usually
+// in tick order too.
+class Telemetry {
+    public:
+        Telemetry(const string &path, int interval);
+        Telemetry(const Telemetry &other) = delete;
+        Telemetry &operator=(const Telemetry &other) = delete;
+        ~Telemetry();
+        void sample(const Simulation &simulation);
+        bool finish();
+
+    private:
+        // Samples waiting to be written, row-major as collected
+        struct Batch {
+            Batch() : ticks(), rowCounts(), rows() {}
+            vector<int> ticks;
+            vector<uint32_t> rowCounts;
+            vector<int> rows; // COLUMNS values per row
+        };
+
+        struct BlockEntry {
+            int64_t lowestTick;
+            int64_t highestTick;
+            uint64_t offset;
+            uint64_t length;
+        };
+
+        static const int COLUMNS = 6;
+        static const size_t SAMPLES_PER_BLOCK = 256;
+        static const size_t ROWS_PER_BLOCK = 1 << 16;
+
+        void run();
+        void writeBlock(const Batch &batch);
+
+        ofstream file;
+        int interval;
+        Batch buffers[2];
+        Batch *filling; // Only touched by the stepping thread
+        Batch *full; // Handed to the writer; null when it is free
+        bool finishing;
+        mutex lock; // Guards full and finishing
+        condition_variable handedOver;
+        condition_variable written;
+        vector<BlockEntry> index; // Like the file, only touched by the writer, then by finish()
+        uint64_t offset; // Where the next block goes
+        thread writer;
+};
@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+using std::string;
+using std::vector;
+
+class Simulation;
+class SnapshotStore;
+
+// Runs several independent simulations (tenants) in one process:
+//   simulation config_file.txt --tenant north.txt --tenant south.txt < commands.txt
+// Tenant 0 is loaded from the first config, the others from their --tenant configs, in
+// order. Tenants whose configs list the same facilities share one catalog store; a
+// tenant that adds a facility moves to a later version of it (or, if it diverges from
+// the others, to a store of its own) without affecting them. "@<tenant> <command>" runs a command on one tenant. A command without a
+// tenant runs on every tenant, each one's output headed by "Tenant <id>:"; "step <n>"
+// steps every tenant at once on one shared thread pool. "tenants" lists the tenants and
+// their catalogs. Each tenant keeps its own backups. Background steps are not available.
+class TenantHost {
+    public:
+        TenantHost(Simulation &first, const string &firstConfigPath, const vector<string> &configPaths);
+        TenantHost(const TenantHost &other) = delete;
+        TenantHost &operator=(const TenantHost &other) = delete;
+        ~TenantHost();
+        void run();
+
+    private:
+        struct Tenant {
+            Simulation *simulation;
+            string configPath;
+            SnapshotStore *snapshots; // Swapped in while one of this tenant's commands runs
+        };
+
+        void dispatch(const string &line);
+        void executeOn(Tenant &tenant, const string &line);
+        void executeOnEvery(const string &line);
+        void stepEvery(const string &line);
+        void printTenants() const;
+        bool isOpen() const;
+
+        Simulation &first; // Tenant 0, owned by the caller
+        vector<Tenant> tenants;
+        ThreadPool pool;
+};
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::deque;
+using std::function;
+using std::vector;
+
+// A fixed-size work-stealing thread pool. Every worker owns a task queue: it
+// takes its own newest task first and, when its queue runs dry, steals the
+// oldest task of another worker.
+class ThreadPool {
+    public:
+        ThreadPool(size_t numOfThreads);
+        ThreadPool(const ThreadPool &other) = delete;
+        ThreadPool &operator=(const ThreadPool &other) = delete;
+        ~ThreadPool();
+        void submit(function<void()> task);
+        void wait();
+        size_t size() const;
+        static size_t defaultSize();
+
+    private:
+        struct Worker {
+            Worker() : lock(), tasks() {}
+            std::mutex lock;
+            deque<function<void()>> tasks;
+        };
+
+        void run(size_t index);
+        bool takeTask(size_t index, function<void()> &task);
+
+        vector<Worker*> workers;
+        vector<std::thread> threads;
+        std::mutex stateLock;
+        std::condition_variable taskAvailable;
+        std::condition_variable allDone;
+        size_t queued; // Tasks waiting in some queue
+        size_t unfinished; // Tasks submitted but not finished yet
+        bool stopping;
+        std::atomic<size_t> nextWorker;
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+using std::atomic;
+using std::string;
+
+// Opt-in timeline of the simulation, written as Chrome/Perfetto trace-event JSON.
+// Each thread appends completed spans to its own buffer without locking; the
+// buffers are merged into the file by finish(). When tracing is off, a span
+// costs one relaxed load.
+class Trace {
+    public:
+        static void start(const string &path);
+        static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+        static void record(const char *name, const char *category, int id, uint64_t startNanos, uint64_t endNanos);
+        static bool finish();
+
+    private:
+        static atomic<bool> enabled;
+};
+
+// Records the lifetime of a scope as a span when tracing is enabled.
+// The name must outlive the span; it is only copied when the span is recorded.
+class TraceSpan {
+    public:
+        TraceSpan(const char *name, const char *category, int id = -1);
+        TraceSpan(const TraceSpan &other) = delete;
+        TraceSpan &operator=(const TraceSpan &other) = delete;
+        ~TraceSpan();
+
+    private:
+        const char *name;
+        const char *category;
+        int id; // Shown as an argument of the span when not -1
+        uint64_t startNanos; // 0 when tracing was off at the start of the scope
+};
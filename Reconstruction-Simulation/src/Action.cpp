@@ -30,15 +30,50 @@ const string &BaseAction::getErrorMsg() const {
     return errorMsg;
 }
 
+// Whether the action only reads the simulation, so it can be answered from a published copy
+bool BaseAction::isReadOnly() const {
+    return false;
+}
+
+// Whether running the action again changes the simulation, so restore --step must replay it
+bool BaseAction::changesState() const {
+    return false;
+}
+
+// Execute a read-only action, printing its output or its error to out
+void BaseAction::answer(const StateReader &state, ostream &out) {
+    try {
+        out << render(state) << flush;
+        complete();
+    } catch (const exception &e) {
+        errorMsg = e.what();
+        out << "Error: " << errorMsg << endl;
+    }
+}
+
+// Output of a read-only action; overridden by every action that reports isReadOnly
+const string BaseAction::render(const StateReader &state) const {
+    throw logic_error("Not a read-only action");
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ************************************************* SimulateStep ***************************************************** //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // Constructor
-SimulateStep::SimulateStep(const int numOfSteps) : numOfSteps(numOfSteps) {}
+SimulateStep::SimulateStep(const int numOfSteps, const bool async) : numOfSteps(numOfSteps), async(async) {}
 
 // Execute the SimulateStep action
 void SimulateStep::act(Simulation &simulation) {
+    if (async) {
+        try {
+            simulation.runAsync(numOfSteps);
+            complete();
+        } catch (const exception &e) {
+            error(e.what());
+        }
+        return;
+    }
     for (int i = 0; i < numOfSteps; i++) {
         simulation.step();
     }
@@ -50,10 +85,22 @@ SimulateStep *SimulateStep::clone() const {
     return new SimulateStep(*this);
 }
 
+bool SimulateStep::changesState() const {
+    return true;
+}
+
+int SimulateStep::getNumOfSteps() const {
+    return numOfSteps;
+}
+
+bool SimulateStep::isAsync() const {
+    return async;
+}
+
 // Convert the SimulateStep action to string
 const string SimulateStep::toString() const {
     ostringstream oss;
-    oss << "step " << numOfSteps << " " 
+    oss << "step " << numOfSteps << (async ? " --async " : " ")
         << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
     return oss.str();
 }
@@ -73,6 +120,7 @@ void AddPlan::act(Simulation &simulation) {
         if (!simulation.isSettlementExists(settlementName)) {
             throw runtime_error("Cannot create this plan");
         }
+        MemoryScope scope(MemoryTag::PLANS);
          // Determine the appropriate SelectionPolicy based on the input string
         SelectionPolicy *policy = nullptr;
         if (selectionPolicy == "eco") {
@@ -86,7 +134,7 @@ void AddPlan::act(Simulation &simulation) {
         } else {
             throw invalid_argument("Cannot create this plan");
         }
-        simulation.addPlan(simulation.getSettlement(settlementName), policy);
+        simulation.addPlan(simulation.getSettlementId(settlementName), policy);
         complete();
     } catch (const exception &e) {
         error(e.what()); 
@@ -98,6 +146,10 @@ AddPlan *AddPlan::clone() const {
     return new AddPlan(*this);
 }
 
+bool AddPlan::changesState() const {
+    return true;
+}
+
 // Convert the AddPlan action to string
 const string AddPlan::toString() const {
     ostringstream oss;
@@ -121,6 +173,7 @@ void AddSettlement::act(Simulation &simulation) {
         if (simulation.isSettlementExists(settlementName)) {
             throw runtime_error("Settlement already exists");
         }
+        MemoryScope scope(MemoryTag::SETTLEMENTS);
         simulation.addSettlement(new Settlement(settlementName, settlementType));
         complete();
     } catch (const exception &e) {
@@ -133,6 +186,10 @@ AddSettlement *AddSettlement::clone() const {
     return new AddSettlement(*this);
 }
 
+bool AddSettlement::changesState() const {
+    return true;
+}
+
 // Convert the AddSettlement action to string
 const string AddSettlement::toString() const {
     ostringstream oss;
@@ -159,6 +216,7 @@ void AddFacility::act(Simulation &simulation) {
         if (simulation.isFacilityExists(facilityName)) {
             throw runtime_error("Facility already exists");
         }
+        MemoryScope scope(MemoryTag::FACILITY_TYPES);
         simulation.addFacility(FacilityType(facilityName, facilityCategory, price,
                                             lifeQualityScore, economyScore, environmentScore));
         complete();
@@ -172,6 +230,10 @@ AddFacility *AddFacility::clone() const {
     return new AddFacility(*this);
 }
 
+bool AddFacility::changesState() const {
+    return true;
+}
+
 // Convert the AddFacility action to string
 const string AddFacility::toString() const {
     ostringstream oss;
@@ -188,19 +250,55 @@ const string AddFacility::toString() const {
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // Constructor
-PrintPlanStatus::PrintPlanStatus(int planId) : planId(planId) {}
+PrintPlanStatus::PrintPlanStatus(int planId, int since) : planId(planId), since(since) {}
 
 // Execute the PrintPlanStatus action
 void PrintPlanStatus::act(Simulation &simulation) {
-    try {
-        if (!simulation.isPlanExists(planId)) {
-            throw runtime_error("Plan doesn't exists");
+    if (since == FULL) {
+        answer(simulation, cout);
+    } else {
+        try {
+            cout << renderChanges(simulation) << flush;
+            complete();
+        } catch (const exception &e) {
+            error(e.what());
         }
-        cout << simulation.getPlan(planId).toString();
-        complete();
-    } catch (const exception &e) {
-        error(e.what());
     }
+    if (getStatus() == ActionStatus::COMPLETED) {
+        simulation.getPlan(planId).markReported();
+    }
+}
+
+// Only --changes depends on what was reported before
+bool PrintPlanStatus::isReadOnly() const {
+    return since != SINCE_LAST_REPORT;
+}
+
+// --changes marks what it printed as reported
+bool PrintPlanStatus::changesState() const {
+    return since == SINCE_LAST_REPORT;
+}
+
+// The full status, which is all a reader on another thread can be asked for
+const string PrintPlanStatus::render(const StateReader &state) const {
+    if (!state.isPlanExists(planId)) {
+        throw runtime_error("Plan doesn't exists");
+    }
+    return state.getPlanDetails(planId);
+}
+
+// Delta modes fall back to the full status when the change log doesn't reach back far enough
+const string PrintPlanStatus::renderChanges(const Simulation &simulation) const {
+    if (!simulation.isPlanExists(planId)) {
+        throw runtime_error("Plan doesn't exists");
+    }
+    const Plan &plan = simulation.getPlan(planId);
+    if (since >= 0 && since >= plan.getLogStart()) {
+        return plan.changesToString(plan.findChanges(since));
+    } else if (since == SINCE_LAST_REPORT && plan.getReported() != Plan::NOT_REPORTED) {
+        return plan.changesToString(plan.getReported());
+    }
+    return plan.toString();
 }
 
 // Clone
@@ -211,8 +309,13 @@ PrintPlanStatus *PrintPlanStatus::clone() const {
 // Convert the PrintPlanStatus action to string
 const string PrintPlanStatus::toString() const {
     ostringstream oss;
-    oss << "planStatus " << planId << " "
-        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    oss << "planStatus " << planId << " ";
+    if (since == SINCE_LAST_REPORT) {
+        oss << "--changes ";
+    } else if (since != FULL) {
+        oss << "--since " << since << " ";
+    }
+    oss << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
     return oss.str();
 }
 
@@ -238,34 +341,15 @@ void ChangePlanPolicy::act(Simulation &simulation) {
         }
 
         // Determine the appropriate SelectionPolicy based on the input string
-        SelectionPolicy *policy = nullptr;
-        if (newPolicy == "eco") {
-            policy = new EconomySelection();
-        } else if (newPolicy == "bal") {
-            // Use existing city scores
-            int lifeQualityScore = plan.getlifeQualityScore();
-            int economyScore = plan.getEconomyScore();
-            int environmentScore = plan.getEnvironmentScore();
-            // Add scores for under-construction facilities
-            const auto &underConstruction = plan.getFacilitiesUnderConstruction();
-            for (const Facility *facility : underConstruction) {
-                lifeQualityScore += facility->getLifeQualityScore();
-                economyScore += facility->getEconomyScore();
-                environmentScore += facility->getEnvironmentScore();
-            }   
-            // Set to a bal selectionPolicy according to the current stats.
-            policy = new BalancedSelection(lifeQualityScore, economyScore, environmentScore); 
-        } else if (newPolicy == "sus") {
-            policy = new SustainabilitySelection();
-        } else if (newPolicy == "nve") {
-            policy = new NaiveSelection();
-        } else {
+        // (a bal policy is set according to the plan's current stats)
+        SelectionPolicy *policy = plan.createPolicy(newPolicy);
+        if (policy == nullptr) {
             throw runtime_error("Cannot change selection policy");
         }
         cout << "planID: " << planId << "\npreviousPolicy: " 
                  << plan.getSelectionPolicy()->toString() << "\nnewPolicy: " 
                  << policy->toString() << endl;
-        plan.setSelectionPolicy(policy);
+        simulation.changePlanPolicy(planId, policy);
         complete();
     } catch (const exception &e) {
         error(e.what());
@@ -277,6 +361,10 @@ ChangePlanPolicy *ChangePlanPolicy::clone() const {
     return new ChangePlanPolicy(*this);
 }
 
+bool ChangePlanPolicy::changesState() const {
+    return true;
+}
+
 // Convert ChangePlanPolicy action to a string
 const string ChangePlanPolicy::toString() const {
     ostringstream oss;
@@ -293,10 +381,19 @@ PrintActionsLog::PrintActionsLog() {}
 
 // Execute the PrintActionsLog action
 void PrintActionsLog::act(Simulation &simulation) {
-    for (const auto &action : simulation.getActionsLog()) {
-        cout << action->toString() << endl;
+    answer(simulation, cout);
+}
+
+bool PrintActionsLog::isReadOnly() const {
+    return true;
+}
+
+const string PrintActionsLog::render(const StateReader &state) const {
+    ostringstream oss;
+    for (size_t i = 0; i < state.getLogSize(); i++) {
+        oss << state.getLogLine(i) << "\n";
     }
-    complete();
+    return oss.str();
 }
 
 // Clone
@@ -340,15 +437,18 @@ const string Close::toString() const {
 // *********************************************** BackupSimulation *************************************************** //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Name under which a plain "backup" is stored
+static const string DEFAULT_SNAPSHOT = "default";
+
 // Constructor 
-BackupSimulation::BackupSimulation() {}
+BackupSimulation::BackupSimulation(const string &snapshotName) : snapshotName(snapshotName) {}
 
 // Execute the BackupSimulation action
 void BackupSimulation::act(Simulation &simulation) {
-    if (backup != nullptr) {
-        delete backup;
+    if (snapshots == nullptr) {
+        snapshots = new SnapshotStore();
     }
-    backup = new Simulation(simulation);
+    snapshots->save(snapshotName.empty() ? DEFAULT_SNAPSHOT : snapshotName, simulation);
     complete();
 }
 
@@ -359,26 +459,39 @@ BackupSimulation *BackupSimulation::clone() const {
 
 // Convert BackupSimulation action to a string
 const string BackupSimulation::toString() const {
-    return "backup COMPLETED";
+    return snapshotName.empty() ? "backup COMPLETED" : "backup " + snapshotName + " COMPLETED";
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ********************************************** RestoreSimulation *************************************************** //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// Constructor
-RestoreSimulation::RestoreSimulation() {}
+// Constructor: restore a snapshot by name
+RestoreSimulation::RestoreSimulation(const string &snapshotName) : snapshotName(snapshotName), targetTick(-1) {}
+
+// Constructor: rewind to a step
+RestoreSimulation::RestoreSimulation(const int targetTick) : snapshotName(), targetTick(targetTick) {}
 
 // Execute the RestoreSimulation action
 void RestoreSimulation::act(Simulation &simulation) {
     try {
-        // Check if a backup exists
-        if (backup == nullptr) {
-            throw runtime_error("No backup available");
+        if (targetTick >= 0) {
+            if (snapshots == nullptr) {
+                throw runtime_error("No snapshot at or before this step");
+            }
+            snapshots->restoreToTick(targetTick, simulation);
+        } else if (snapshotName.empty()) {
+            // Check if a backup exists
+            if (snapshots == nullptr || !snapshots->contains(DEFAULT_SNAPSHOT)) {
+                throw runtime_error("No backup available");
+            }
+            snapshots->restore(DEFAULT_SNAPSHOT, simulation);
+        } else {
+            if (snapshots == nullptr || !snapshots->contains(snapshotName)) {
+                throw runtime_error("Snapshot not found");
+            }
+            snapshots->restore(snapshotName, simulation);
         }
-
-        // Restore the simulation by overwriting the current state with the backup
-        simulation = *backup; 
         complete();
     } catch (const exception &e) {
         error(e.what());
@@ -393,7 +506,789 @@ RestoreSimulation *RestoreSimulation::clone() const {
 // Convert RestoreSimulation action to a string
 const string RestoreSimulation::toString() const {
     ostringstream oss;
-    oss << "restore "
+    oss << "restore ";
+    if (targetTick >= 0) {
+        oss << "--step " << targetTick << " ";
+    } else if (!snapshotName.empty()) {
+        oss << snapshotName << " ";
+    }
+    oss << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// *********************************************** PrintSnapshots ***************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+PrintSnapshots::PrintSnapshots() {}
+
+// Execute the PrintSnapshots action
+void PrintSnapshots::act(Simulation &simulation) {
+    if (snapshots == nullptr) {
+        cout << "No snapshots" << endl;
+    } else {
+        cout << snapshots->toString();
+    }
+    complete();
+}
+
+// Clone
+PrintSnapshots *PrintSnapshots::clone() const {
+    return new PrintSnapshots(*this);
+}
+
+// Convert PrintSnapshots action to a string
+const string PrintSnapshots::toString() const {
+    return "snapshots COMPLETED";
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ************************************************ PolicySweep ******************************************************* //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Final scores of one (plan, policy) candidate
+struct SweepResult {
+    SweepResult() : planId(0), policy(), lifeQualityScore(0), economyScore(0), environmentScore(0), failed(false) {}
+    int planId;
+    string policy;
+    int lifeQualityScore;
+    int economyScore;
+    int environmentScore;
+    bool failed;
+};
+
+// Constructor
+PolicySweep::PolicySweep(const int numOfSteps) : numOfSteps(numOfSteps) {}
+
+// Execute the PolicySweep action: run every plan under every policy on a copy and rank the results
+void PolicySweep::act(Simulation &simulation) {
+    static const vector<string> POLICIES = {"nve", "bal", "eco", "sus"};
+    const deque<Plan> &plans = simulation.getPlans();
+    vector<SweepResult> results(plans.size() * POLICIES.size());
+
+    {
+        ThreadPool pool(ThreadPool::defaultSize());
+        for (size_t i = 0; i < plans.size(); i++) {
+            for (size_t j = 0; j < POLICIES.size(); j++) {
+                const Plan &plan = plans[i];
+                SweepResult &result = results[i * POLICIES.size() + j];
+                const string &policyName = POLICIES[j];
+                const int steps = numOfSteps;
+                pool.submit([&plan, &result, &policyName, steps] {
+                    // The copy shares the settlement and facility tables with the original
+                    Plan candidate(plan);
+                    if (plan.getSelectionPolicy()->toString() != policyName) {
+                        candidate.setSelectionPolicy(plan.createPolicy(policyName));
+                    }
+                    result.planId = plan.getPlanId();
+                    result.policy = policyName;
+                    result.failed = false;
+                    try {
+                        for (int k = 0; k < steps; k++) {
+                            candidate.step();
+                        }
+                    } catch (const exception &e) {
+                        result.failed = true;
+                    }
+                    result.lifeQualityScore = candidate.getlifeQualityScore();
+                    result.economyScore = candidate.getEconomyScore();
+                    result.environmentScore = candidate.getEnvironmentScore();
+                });
+            }
+        }
+        pool.wait();
+    }
+
+    // Rank each plan's candidates by total score, failed runs last
+    for (size_t i = 0; i < plans.size(); i++) {
+        auto first = results.begin() + i * POLICIES.size();
+        stable_sort(first, first + POLICIES.size(), [](const SweepResult &a, const SweepResult &b) {
+            if (a.failed != b.failed) return !a.failed;
+            return a.lifeQualityScore + a.economyScore + a.environmentScore >
+                   b.lifeQualityScore + b.economyScore + b.environmentScore;
+        });
+        cout << "PlanID: " << plans[i].getPlanId() << "\n";
+        cout << "SettlementName: " << plans[i].getSettlement().getName() << "\n";
+        for (size_t rank = 0; rank < POLICIES.size(); rank++) {
+            const SweepResult &result = *(first + rank);
+            cout << rank + 1 << ". " << result.policy;
+            if (result.failed) {
+                cout << " ERROR\n";
+                continue;
+            }
+            cout << " LifeQuality_Score: " << result.lifeQualityScore
+                 << " Economy_Score: " << result.economyScore
+                 << " Environment_Score: " << result.environmentScore
+                 << " Total: " << result.lifeQualityScore + result.economyScore + result.environmentScore << "\n";
+        }
+        cout << "----------------------------------------" << endl;
+    }
+    complete();
+}
+
+// Clone
+PolicySweep *PolicySweep::clone() const {
+    return new PolicySweep(*this);
+}
+
+// Convert PolicySweep action to a string
+const string PolicySweep::toString() const {
+    ostringstream oss;
+    oss << "sweep " << numOfSteps << " "
+        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ******************************************** SearchPolicySchedule ************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+SearchPolicySchedule::SearchPolicySchedule(const int planId, const int numOfSteps, const int windowSize, const int lifeQualityWeight,
+                                           const int economyWeight, const int environmentWeight, const int budgetMs)
+    : planId(planId), numOfSteps(numOfSteps), windowSize(windowSize), lifeQualityWeight(lifeQualityWeight),
+      economyWeight(economyWeight), environmentWeight(environmentWeight), budgetMs(budgetMs) {}
+
+// Execute the SearchPolicySchedule action: find the best policy per window for one plan
+void SearchPolicySchedule::act(Simulation &simulation) {
+    try {
+        if (!simulation.isPlanExists(planId)) {
+            throw runtime_error("Plan doesn't exists");
+        }
+        if (numOfSteps <= 0 || windowSize <= 0 || budgetMs <= 0) {
+            throw runtime_error("Invalid schedule search");
+        }
+        ThreadPool pool(ThreadPool::defaultSize());
+        ScheduleSearch search(simulation.getPlan(planId), numOfSteps, windowSize, lifeQualityWeight, economyWeight, environmentWeight);
+        search.run(budgetMs, pool);
+
+        // Print runs of windows that share a policy as one line
+        const vector<string> &schedule = search.getSchedule();
+        cout << "PlanID: " << planId << "\n";
+        for (size_t i = 0; i < schedule.size(); ) {
+            size_t j = i;
+            while (j + 1 < schedule.size() && schedule[j + 1] == schedule[i]) j++;
+            cout << "Steps " << i * windowSize + 1 << "-" << min<long>((j + 1) * windowSize, numOfSteps)
+                 << ": " << schedule[i] << "\n";
+            i = j + 1;
+        }
+        const Plan &result = search.getResult();
+        cout << "LifeQuality_Score: " << result.getlifeQualityScore() << "\n";
+        cout << "Economy_Score: " << result.getEconomyScore() << "\n";
+        cout << "Environment_Score: " << result.getEnvironmentScore() << "\n";
+        cout << "WeightedScore: " << search.getWeightedScore() << "\n";
+        cout << "StatesExplored: " << search.getStatesExplored() << "\n";
+        cout << "StatesMerged: " << search.getStatesMerged() << "\n";
+        cout << "SearchFinished: " << (search.isFinished() ? "YES" : "NO (time budget reached)") << endl;
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+SearchPolicySchedule *SearchPolicySchedule::clone() const {
+    return new SearchPolicySchedule(*this);
+}
+
+// Convert SearchPolicySchedule action to a string
+const string SearchPolicySchedule::toString() const {
+    ostringstream oss;
+    oss << "schedule " << planId << " " << numOfSteps << " " << windowSize << " "
+        << lifeQualityWeight << " " << economyWeight << " " << environmentWeight << " " << budgetMs << " "
+        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ***************************************************** ForkPlan ***************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+ForkPlan::ForkPlan(const int planId) : planId(planId) {}
+
+// Execute the ForkPlan action: copy one plan for what-if experiments
+void ForkPlan::act(Simulation &simulation) {
+    try {
+        if (!simulation.isPlanExists(planId)) {
+            throw runtime_error("Plan doesn't exists");
+        }
+        simulation.forkPlan(planId);
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+ForkPlan *ForkPlan::clone() const {
+    return new ForkPlan(*this);
+}
+
+bool ForkPlan::changesState() const {
+    return true;
+}
+
+// Convert ForkPlan action to a string
+const string ForkPlan::toString() const {
+    ostringstream oss;
+    oss << "fork " << planId << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ***************************************************** StepFork ***************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+StepFork::StepFork(const int planId, const int numOfSteps) : planId(planId), numOfSteps(numOfSteps) {}
+
+// Execute the StepFork action: advance only the fork, on its own ticks
+void StepFork::act(Simulation &simulation) {
+    try {
+        Plan &fork = simulation.getFork(planId);
+        for (int i = 0; i < numOfSteps; i++) {
+            fork.step();
+            fork.setTick(fork.getTick() + 1);
+        }
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+StepFork *StepFork::clone() const {
+    return new StepFork(*this);
+}
+
+bool StepFork::changesState() const {
+    return true;
+}
+
+// Convert StepFork action to a string
+const string StepFork::toString() const {
+    ostringstream oss;
+    oss << "forkStep " << planId << " " << numOfSteps << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ************************************************* ChangeForkPolicy ************************************************* //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+ChangeForkPolicy::ChangeForkPolicy(const int planId, const string &newPolicy) : planId(planId), newPolicy(newPolicy) {}
+
+// Execute the ChangeForkPolicy action: same rules as changePolicy, applied to the fork
+void ChangeForkPolicy::act(Simulation &simulation) {
+    try {
+        if (!simulation.isForked(planId)) {
+            throw runtime_error("Cannot change selection policy");
+        }
+        Plan &fork = simulation.getFork(planId);
+        if (fork.getSelectionPolicy()->toString() == newPolicy) {
+            throw runtime_error("Cannot change selection policy");
+        }
+        SelectionPolicy *policy = fork.createPolicy(newPolicy);
+        if (policy == nullptr) {
+            throw runtime_error("Cannot change selection policy");
+        }
+        cout << "planID: " << planId << " (fork)\npreviousPolicy: "
+             << fork.getSelectionPolicy()->toString() << "\nnewPolicy: "
+             << policy->toString() << endl;
+        fork.setSelectionPolicy(policy);
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+ChangeForkPolicy *ChangeForkPolicy::clone() const {
+    return new ChangeForkPolicy(*this);
+}
+
+bool ChangeForkPolicy::changesState() const {
+    return true;
+}
+
+// Convert ChangeForkPolicy action to a string
+const string ChangeForkPolicy::toString() const {
+    ostringstream oss;
+    oss << "forkPolicy " << planId << " " << newPolicy << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ************************************************* PrintForkStatus ************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+PrintForkStatus::PrintForkStatus(const int planId) : planId(planId) {}
+
+// Execute the PrintForkStatus action: print the fork and how its scores compare to the plan
+void PrintForkStatus::act(Simulation &simulation) {
+    try {
+        const Plan &fork = simulation.getFork(planId);
+        const Plan &plan = simulation.getPlan(planId);
+        cout << fork.toString();
+        cout << "LifeQualityScoreDelta: " << showpos << fork.getlifeQualityScore() - plan.getlifeQualityScore() << "\n";
+        cout << "EconomyScoreDelta: " << fork.getEconomyScore() - plan.getEconomyScore() << "\n";
+        cout << "EnvironmentScoreDelta: " << fork.getEnvironmentScore() - plan.getEnvironmentScore() << noshowpos << endl;
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+PrintForkStatus *PrintForkStatus::clone() const {
+    return new PrintForkStatus(*this);
+}
+
+// Convert PrintForkStatus action to a string
+const string PrintForkStatus::toString() const {
+    ostringstream oss;
+    oss << "forkStatus " << planId << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// **************************************************** CommitFork **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+CommitFork::CommitFork(const int planId) : planId(planId) {}
+
+// Execute the CommitFork action: the fork replaces its plan
+void CommitFork::act(Simulation &simulation) {
+    try {
+        simulation.commitFork(planId);
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+CommitFork *CommitFork::clone() const {
+    return new CommitFork(*this);
+}
+
+bool CommitFork::changesState() const {
+    return true;
+}
+
+// Convert CommitFork action to a string
+const string CommitFork::toString() const {
+    ostringstream oss;
+    oss << "commit " << planId << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// *************************************************** DiscardFork **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+DiscardFork::DiscardFork(const int planId) : planId(planId) {}
+
+// Execute the DiscardFork action: drop the fork, the plan is untouched
+void DiscardFork::act(Simulation &simulation) {
+    try {
+        simulation.discardFork(planId);
+        complete();
+    } catch (const exception &e) {
+        error(e.what());
+    }
+}
+
+// Clone
+DiscardFork *DiscardFork::clone() const {
+    return new DiscardFork(*this);
+}
+
+bool DiscardFork::changesState() const {
+    return true;
+}
+
+// Convert DiscardFork action to a string
+const string DiscardFork::toString() const {
+    ostringstream oss;
+    oss << "discard " << planId << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ************************************************** PrintTopPlans *************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+PrintTopPlans::PrintTopPlans(const string &metric, const int k) : metric(metric), k(k) {}
+
+// Execute the PrintTopPlans action
+void PrintTopPlans::act(Simulation &simulation) {
+    answer(simulation, cout);
+}
+
+bool PrintTopPlans::isReadOnly() const {
+    return true;
+}
+
+// The k best plans by one score
+const string PrintTopPlans::render(const StateReader &state) const {
+    ScoreMetric scoreMetric;
+    if (!PlanViews::parseMetric(metric, scoreMetric) || k < 0) {
+        throw runtime_error("Invalid metric");
+    }
+    const PlanViews &views = state.getViews();
+    ostringstream oss;
+    int rank = 1;
+    for (const auto &entry : views.top(scoreMetric, k)) {
+        oss << rank++ << ". PlanID: " << entry.first
+            << " SettlementName: " << state.getSettlementName(views.getSettlementId(entry.first))
+            << " Score: " << entry.second << "\n";
+    }
+    return oss.str();
+}
+
+// Clone
+PrintTopPlans *PrintTopPlans::clone() const {
+    return new PrintTopPlans(*this);
+}
+
+// Convert PrintTopPlans action to a string
+const string PrintTopPlans::toString() const {
+    ostringstream oss;
+    oss << "top " << metric << " " << k << " " << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ************************************************* PrintAggregates ************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+PrintAggregates::PrintAggregates(const string &settlementName) : settlementName(settlementName) {}
+
+// Execute the PrintAggregates action
+void PrintAggregates::act(Simulation &simulation) {
+    answer(simulation, cout);
+}
+
+bool PrintAggregates::isReadOnly() const {
+    return true;
+}
+
+const string PrintAggregates::render(const StateReader &state) const {
+    if (settlementName.empty()) {
+        return state.getViews().toString();
+    }
+    if (!state.isSettlementExists(settlementName)) {
+        throw runtime_error("Settlement not found");
+    }
+    return "SettlementName: " + settlementName + " "
+           + state.getViews().settlementToString(state.getSettlementId(settlementName)) + "\n";
+}
+
+// Clone
+PrintAggregates *PrintAggregates::clone() const {
+    return new PrintAggregates(*this);
+}
+
+// Convert PrintAggregates action to a string
+const string PrintAggregates::toString() const {
+    ostringstream oss;
+    oss << "aggregate " << (settlementName.empty() ? "" : settlementName + " ") << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// **************************************************** QueryPlans **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Constructor
+QueryPlans::QueryPlans(const vector<string> &conditions) : conditions(conditions) {}
+
+// Execute the QueryPlans action
+void QueryPlans::act(Simulation &simulation) {
+    answer(simulation, cout);
+}
+
+bool QueryPlans::isReadOnly() const {
+    return true;
+}
+
+// Every plan matching all conditions, one line each
+const string QueryPlans::render(const StateReader &state) const {
+    PlanQuery query = parseQuery(state);
+    ostringstream oss;
+    const PlanViews &views = state.getViews();
+    size_t matches = views.query(query, [&state, &views, &oss](int planId) {
+        oss << "PlanID: " << planId
+            << " SettlementName: " << state.getSettlementName(views.getSettlementId(planId))
+            << " " << views.planToString(planId) << "\n";
+    });
+    oss << "Matches: " << matches << "\n";
+    return oss.str();
+}
+
+// Clone
+QueryPlans *QueryPlans::clone() const {
+    return new QueryPlans(*this);
+}
+
+// Convert QueryPlans action to a string
+const string QueryPlans::toString() const {
+    ostringstream oss;
+    oss << "plans ";
+    if (!conditions.empty()) {
+        oss << "where ";
+        for (const string &condition : conditions) {
+            oss << condition << " ";
+        }
+    }
+    oss << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+// Turn the conditions into a query; repeated score bounds narrow the range
+PlanQuery QueryPlans::parseQuery(const StateReader &state) const {
+    PlanQuery query;
+    for (const string &condition : conditions) {
+        size_t opStart = condition.find_first_of("<>=");
+        if (opStart == string::npos || opStart == 0) {
+            throw runtime_error("Invalid condition");
+        }
+        size_t valueStart = opStart + 1;
+        if (valueStart < condition.size() && condition[valueStart] == '=') valueStart++;
+        const string field = condition.substr(0, opStart);
+        const string op = condition.substr(opStart, valueStart - opStart);
+        const string value = condition.substr(valueStart);
+        if (value.empty()) {
+            throw runtime_error("Invalid condition");
+        }
+
+        ScoreMetric metric;
+        if (PlanViews::parseMetric(field, metric)) {
+            if (op == "==") throw runtime_error("Invalid condition");
+            int bound = stoi(value);
+            int index = static_cast<int>(metric);
+            if (op == "=" || op == ">=") query.minScores[index] = max(query.minScores[index], bound);
+            if (op == "=" || op == "<=") query.maxScores[index] = min(query.maxScores[index], bound);
+            if (op == ">") query.minScores[index] = max(query.minScores[index], bound + 1);
+            if (op == "<") query.maxScores[index] = min(query.maxScores[index], bound - 1);
+            continue;
+        }
+        if (op != "=") {
+            throw runtime_error("Invalid condition");
+        }
+        if (field == "settlement") {
+            if (!state.isSettlementExists(value)) {
+                throw runtime_error("Settlement not found");
+            }
+            query.settlementId = state.getSettlementId(value);
+        } else if (field == "type") {
+            query.settlementType = stoi(value);
+            if (query.settlementType < 0 || query.settlementType > 2) {
+                throw runtime_error("Invalid settlement type");
+            }
+        } else if (field == "policy") {
+            query.policy = PlanViews::parsePolicy(value);
+            if (query.policy < 0) {
+                throw runtime_error("Invalid policy");
+            }
+        } else if (field == "status") {
+            if (value == "AVAILABLE") query.status = static_cast<int>(PlanStatus::AVALIABLE);
+            else if (value == "BUSY") query.status = static_cast<int>(PlanStatus::BUSY);
+            else throw runtime_error("Invalid status");
+        } else {
+            throw runtime_error("Invalid condition");
+        }
+    }
+    return query;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// **************************************************** PrintStats **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Constructor
+PrintStats::PrintStats() {}
+
+// Execute the PrintStats action
+void PrintStats::act(Simulation &simulation) {
+    answer(simulation, cout);
+}
+
+bool PrintStats::isReadOnly() const {
+    return true;
+}
+
+// Counters and latencies since the process started
+const string PrintStats::render(const StateReader &state) const {
+    return Stats::toString();
+}
+
+// Clone
+PrintStats *PrintStats::clone() const {
+    return new PrintStats(*this);
+}
+
+// Convert PrintStats action to a string
+const string PrintStats::toString() const {
+    ostringstream oss;
+    oss << "stats "
         << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
     return oss.str();
-}
\ No newline at end of file
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// *************************************************** PrintMemory **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Constructor
+PrintMemory::PrintMemory() {}
+
+// Execute the PrintMemory action
+void PrintMemory::act(Simulation &simulation) {
+    answer(simulation, cout);
+}
+
+bool PrintMemory::isReadOnly() const {
+    return true;
+}
+
+// Live heap memory by subsystem
+const string PrintMemory::render(const StateReader &state) const {
+    return Memory::toString();
+}
+
+// Clone
+PrintMemory *PrintMemory::clone() const {
+    return new PrintMemory(*this);
+}
+
+// Convert PrintMemory action to a string
+const string PrintMemory::toString() const {
+    ostringstream oss;
+    oss << "mem "
+        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// *************************************************** PrintScores **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Constructor
+PrintScores::PrintScores() {}
+
+// Execute the PrintScores action; without a published view, from the simulation
+void PrintScores::act(Simulation &simulation) {
+    EpochGuard guard;
+    if (StateView::latest() == nullptr) {
+        answer(StateView(simulation), cout);
+    } else {
+        answer(simulation, cout);
+    }
+}
+
+bool PrintScores::isReadOnly() const {
+    return true;
+}
+
+// Every plan's status and scores from the latest published view, which may be newer than
+// the state a reader was given (e.g. during a long step), or from the given state's own view
+const string PrintScores::render(const StateReader &state) const {
+    EpochGuard guard;
+    const StateView *view = StateView::latest();
+    if (view == nullptr) {
+        view = dynamic_cast<const StateView*>(&state);
+    }
+    if (view == nullptr) {
+        throw logic_error("No published view");
+    }
+    return view->toString();
+}
+
+// Clone
+PrintScores *PrintScores::clone() const {
+    return new PrintScores(*this);
+}
+
+// Convert PrintScores action to a string
+const string PrintScores::toString() const {
+    ostringstream oss;
+    oss << "scores "
+        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ************************************************** PrintProgress *************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Constructor
+PrintProgress::PrintProgress() {}
+
+// Execute the PrintProgress action. Not read-only: it reports the live run, which
+// published copies don't have.
+void PrintProgress::act(Simulation &simulation) {
+    const StepRunner *runner = simulation.getRunner();
+    cout << (runner == nullptr ? "No background run\n" : runner->progress()) << flush;
+    complete();
+}
+
+// Clone
+PrintProgress *PrintProgress::clone() const {
+    return new PrintProgress(*this);
+}
+
+// Convert PrintProgress action to a string
+const string PrintProgress::toString() const {
+    ostringstream oss;
+    oss << "progress "
+        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// **************************************************** CancelRun ***************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+
+// Constructor
+CancelRun::CancelRun() {}
+
+// Execute the CancelRun action: stops the background run at the next tick boundary
+void CancelRun::act(Simulation &simulation) {
+    StepRunner *runner = simulation.getRunner();
+    if (runner == nullptr || !runner->isActive()) {
+        error("No background run in progress");
+        return;
+    }
+    int ticks = runner->cancel();
+    cout << "Cancelled after " << ticks << " ticks, at tick " << simulation.getTick() << endl;
+    complete();
+}
+
+// Clone
+CancelRun *CancelRun::clone() const {
+    return new CancelRun(*this);
+}
+
+// Convert CancelRun action to a string
+const string CancelRun::toString() const {
+    ostringstream oss;
+    oss << "cancel "
+        << ((getStatus() == ActionStatus::COMPLETED) ? "COMPLETED" : "ERROR");
+    return oss.str();
+}
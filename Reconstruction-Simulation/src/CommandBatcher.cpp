@@ -0,0 +1,186 @@
+#include "CommandBatcher.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "Memory.h"
+#include "MetricsServer.h"
+#include "StepRunner.h"
+
+#include <unistd.h>
+
+// No rule of 3 needed - the batcher only refers to the simulation.
+
+namespace {
+
+// How much of stdin is read at once, and how much output is passed on at once
+const size_t READ_SIZE = 1 << 16;
+const size_t WRITE_SIZE = 1 << 16;
+
+// Passes output on to the console in large writes. Flushes (endl) are deferred to the
+// end of the batch, without holding the whole batch's output in memory.
+class DeferredOutput : public streambuf {
+    public:
+        explicit DeferredOutput(streambuf *console) : console(console), buffer(WRITE_SIZE) {
+            setp(buffer.data(), buffer.data() + buffer.size());
+        }
+        DeferredOutput(const DeferredOutput &other) = delete;
+        DeferredOutput &operator=(const DeferredOutput &other) = delete;
+
+        void flush() {
+            drain();
+            console->pubsync();
+        }
+
+    protected:
+        int overflow(int c) override {
+            drain();
+            if (c != traits_type::eof()) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+
+        int sync() override {
+            return 0; // Deferred to flush()
+        }
+
+    private:
+        void drain() {
+            console->sputn(pbase(), pptr() - pbase());
+            setp(buffer.data(), buffer.data() + buffer.size());
+        }
+
+        streambuf *console;
+        vector<char> buffer;
+};
+
+} // namespace
+
+// Constructor
+CommandBatcher::CommandBatcher(Simulation &simulation, size_t maxLines)
+    : simulation(simulation), maxLines(maxLines == 0 ? 1 : maxLines) {}
+
+// Command loop: executes whatever complete lines have arrived (up to maxLines at a time),
+// reading stdin in large chunks, until close or the end of the input
+void CommandBatcher::run() {
+    simulation.open();
+    MetricsServer::publish(simulation);
+
+    string pending; // Read but not yet executed
+    size_t start = 0; // Where pending's first unexecuted line starts
+    bool ended = false;
+    vector<string> lines;
+    char buffer[READ_SIZE];
+    DeferredOutput output(cout.rdbuf());
+    streambuf *console = cout.rdbuf(&output);
+    while (simulation.isOpen()) {
+        lines.clear();
+        size_t lineEnd;
+        while (lines.size() < maxLines && (lineEnd = pending.find('\n', start)) != string::npos) {
+            lines.push_back(pending.substr(start, lineEnd - start));
+            start = lineEnd + 1;
+        }
+        if (lines.empty() && ended) {
+            if (start < pending.size()) lines.push_back(pending.substr(start));
+            start = pending.size();
+            if (lines.empty()) break;
+        }
+        if (!lines.empty()) {
+            executeBatch(lines);
+            output.flush();
+            continue;
+        }
+        // Nothing complete left: keep the partial line and wait for more
+        pending.erase(0, start);
+        start = 0;
+        ssize_t received = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if (received <= 0) {
+            ended = true;
+        } else {
+            pending.append(buffer, received);
+        }
+    }
+    output.flush();
+    cout.rdbuf(console);
+}
+
+// Executes one batch
+void CommandBatcher::executeBatch(const vector<string> &lines) {
+    vector<vector<string>> args;
+    args.reserve(lines.size());
+    for (const string &line : lines) {
+        args.push_back(Auxiliary::parseArguments(line));
+    }
+
+    size_t next = 0;
+    while (next < lines.size() && simulation.isOpen()) {
+        size_t last = next + 1;
+        if (isStep(args[next])) {
+            while (last < lines.size() && isStep(args[last])) last++;
+            executeSteps(args, next, last);
+        } else if (isInsertion(args[next])) {
+            size_t settlementCount = 0, planCount = 0;
+            last = next;
+            for (; last < lines.size() && isInsertion(args[last]); last++) {
+                if (args[last][0] == "settlement") settlementCount++;
+                else if (args[last][0] == "plan") planCount++;
+            }
+            simulation.reserve(settlementCount, planCount, last - next);
+            for (size_t i = next; i < last && simulation.isOpen(); i++) {
+                simulation.executeLine(lines[i]);
+            }
+        } else {
+            simulation.executeLine(lines[next]);
+        }
+        next = last;
+    }
+}
+
+// Runs adjacent "step <n>" lines as one stretch of steps, then logs each line as if it ran alone
+void CommandBatcher::executeSteps(const vector<vector<string>> &args, size_t first, size_t last) {
+    RunPause pause(simulation);
+    TraceSpan span("step", "command");
+    vector<BaseAction*> actions;
+    long long ticks = 0;
+    {
+        MemoryScope scope(MemoryTag::ACTIONS_LOG);
+        for (size_t i = first; i < last; i++) {
+            int numOfSteps = stoi(args[i][1]);
+            actions.push_back(new SimulateStep(numOfSteps));
+            ticks += max(numOfSteps, 0);
+        }
+    }
+
+    uint64_t start = Stats::now();
+    for (long long tick = 0; tick < ticks; tick++) {
+        simulation.step();
+    }
+    uint64_t share = (Stats::now() - start) / actions.size();
+
+    simulation.reserve(0, 0, actions.size());
+    MemoryScope scope(MemoryTag::ACTIONS_LOG);
+    for (BaseAction *action : actions) {
+        action->complete();
+        Stats::recordCommand("step", share, false);
+        simulation.addAction(action);
+    }
+    MetricsServer::publish(simulation);
+}
+
+// A synchronous "step <n>" that parses
+bool CommandBatcher::isStep(const vector<string> &args) {
+    if (args.size() != 2 || args[0] != "step") return false;
+    try {
+        stoi(args[1]);
+        return true;
+    } catch (const exception &e) {
+        return false;
+    }
+}
+
+// A line that adds a settlement, facility type or plan
+bool CommandBatcher::isInsertion(const vector<string> &args) {
+    return !args.empty() && (args[0] == "settlement" || args[0] == "facility" || args[0] == "plan");
+}
@@ -0,0 +1,181 @@
+#include "CommandInputs.h"
+#include "Simulation.h"
+#include "MetricsServer.h"
+
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Rule of 3: copying is deleted, the destructor stops the readers and closes the inputs.
+
+namespace {
+
+// How long readers and the executor wait for input before checking whether to stop
+const int POLL_INTERVAL_MS = 100;
+
+// Opens one input for reading, or returns -1
+int openInput(const string &path) {
+    if (path == "-") return dup(STDIN_FILENO);
+    struct stat info;
+    if (stat(path.c_str(), &info) < 0) return -1;
+    if (S_ISSOCK(info.st_mode)) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) return -1;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    // Held open for writing too, so the FIFO neither blocks here nor ends when a writer leaves
+    return open(path.c_str(), S_ISFIFO(info.st_mode) ? O_RDWR : O_RDONLY);
+}
+
+} // namespace
+
+// Constructor: opens every input; reading starts once run() starts
+CommandInputs::CommandInputs(const vector<string> &paths) : fds(), live(), readers(), stopping(false), queue() {
+    for (const string &path : paths) {
+        int fd = openInput(path);
+        if (fd < 0) {
+            for (int opened : fds) {
+                close(opened);
+            }
+            throw runtime_error("Unable to open input " + path);
+        }
+        fds.push_back(fd);
+        // Only a regular file is sure to deliver its next line; anything else may wait for a person or a program
+        struct stat info;
+        live.push_back(fstat(fd, &info) < 0 || !S_ISREG(info.st_mode));
+    }
+}
+
+// Destructor
+CommandInputs::~CommandInputs() {
+    stop();
+    for (int fd : fds) {
+        close(fd);
+    }
+}
+
+// Executor loop: runs the files' lines in (sequence, input) order and live inputs' lines
+// as they arrive, until the simulation is closed or every input has ended
+void CommandInputs::run(Simulation &simulation) {
+    simulation.open();
+    MetricsServer::publish(simulation);
+    for (size_t input = 0; input < fds.size(); input++) {
+        readers.emplace_back(&CommandInputs::read, this, input);
+    }
+
+    vector<std::deque<CommandEntry*>> pending(fds.size()); // Drained lines of files, per input
+    vector<bool> ended(fds.size(), false);
+    size_t active = fds.size();
+    size_t files = 0; // Files that have not ended
+    for (size_t input = 0; input < fds.size(); input++) {
+        if (!live[input]) files++;
+    }
+    size_t turn = 0; // The file whose line is next
+    uint64_t round = 0; // The sequence number that is next
+    while (turn < fds.size() && live[turn]) {
+        turn++;
+    }
+
+    vector<CommandEntry*> batch;
+    while (simulation.isOpen() && active > 0) {
+        batch.clear();
+        if (queue.drain(batch) == 0) {
+            queue.wait(POLL_INTERVAL_MS);
+            continue;
+        }
+        for (CommandEntry *entry : batch) {
+            if (!live[entry->producer]) {
+                pending[entry->producer].push_back(entry);
+                continue;
+            }
+            if (!simulation.isOpen()) {
+                // Lines queued behind close are dropped
+            } else if (entry->end) {
+                active--;
+            } else {
+                simulation.executeLine(entry->line);
+            }
+            delete entry;
+        }
+
+        // Run file lines until the file whose turn it is has not been read that far yet
+        while (simulation.isOpen() && files > 0 && !pending[turn].empty()) {
+            CommandEntry *entry = pending[turn].front();
+            pending[turn].pop_front();
+            if (entry->sequence != round) {
+                delete entry;
+                throw logic_error("Input lines arrived out of order");
+            }
+            if (entry->end) {
+                ended[turn] = true;
+                active--;
+                files--;
+            } else {
+                simulation.executeLine(entry->line);
+            }
+            delete entry;
+            // Next file that has not ended; passing the last one starts the next round
+            while (files > 0) {
+                if (++turn == fds.size()) {
+                    turn = 0;
+                    round++;
+                }
+                if (!live[turn] && !ended[turn]) break;
+            }
+        }
+    }
+    stop();
+    for (auto &lines : pending) {
+        for (CommandEntry *entry : lines) {
+            delete entry;
+        }
+    }
+}
+
+// Reader thread: pushes the input's lines, numbered from 0, then an end marker
+void CommandInputs::read(int input) {
+    uint64_t sequence = 0;
+    string partial;
+    char buffer[4096];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        pollfd waiting = {fds[input], POLLIN, 0};
+        if (poll(&waiting, 1, POLL_INTERVAL_MS) <= 0) continue;
+        ssize_t received = ::read(fds[input], buffer, sizeof(buffer));
+        if (received <= 0) break;
+        partial.append(buffer, received);
+        size_t start = 0;
+        size_t lineEnd;
+        while ((lineEnd = partial.find('\n', start)) != string::npos) {
+            queue.push(new CommandEntry(input, sequence++, partial.substr(start, lineEnd - start), false));
+            start = lineEnd + 1;
+        }
+        partial.erase(0, start);
+    }
+    if (stopping.load(std::memory_order_relaxed)) return;
+    if (!partial.empty()) {
+        queue.push(new CommandEntry(input, sequence++, partial, false));
+    }
+    queue.push(new CommandEntry(input, sequence, "", true));
+}
+
+// Stops the readers and waits for them
+void CommandInputs::stop() {
+    stopping.store(true);
+    for (thread &reader : readers) {
+        if (reader.joinable()) reader.join();
+    }
+}
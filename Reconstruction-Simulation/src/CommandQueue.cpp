@@ -0,0 +1,89 @@
+#include "CommandQueue.h"
+
+#include <chrono>
+
+// Rule of 3: copying is deleted, the destructor frees the entries still queued.
+
+// Constructor for the stub entry
+CommandEntry::CommandEntry() : producer(-1), sequence(0), line(), end(false), next(nullptr) {}
+
+// Constructor
+CommandEntry::CommandEntry(int producer, uint64_t sequence, const string &line, bool end)
+    : producer(producer), sequence(sequence), line(line), end(end), next(nullptr) {}
+
+// Constructor
+CommandQueue::CommandQueue() : head(nullptr), tail(nullptr), stub(), sleeping(false), sleepLock(), pushed() {
+    head.store(&stub);
+    tail = &stub;
+}
+
+// Destructor
+CommandQueue::~CommandQueue() {
+    CommandEntry *entry;
+    while ((entry = pop()) != nullptr) {
+        delete entry;
+    }
+}
+
+// Appends an entry; called by any number of producers at once. Takes ownership of it.
+void CommandQueue::push(CommandEntry *entry) {
+    link(entry);
+    if (sleeping.load()) {
+        std::lock_guard<std::mutex> lock(sleepLock);
+        pushed.notify_one();
+    }
+}
+
+// Moves every entry that is fully linked into batch, oldest first; returns how many
+size_t CommandQueue::drain(vector<CommandEntry*> &batch) {
+    size_t count = 0;
+    CommandEntry *entry;
+    while ((entry = pop()) != nullptr) {
+        batch.push_back(entry);
+        count++;
+    }
+    return count;
+}
+
+// Blocks the consumer until something is pushed or the timeout passes
+void CommandQueue::wait(int timeoutMs) {
+    sleeping.store(true);
+    std::unique_lock<std::mutex> lock(sleepLock);
+    pushed.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] {
+        return tail->next.load() != nullptr || head.load() != tail;
+    });
+    sleeping.store(false);
+}
+
+// Between the swap and the store the entry is unreachable from tail; pop() then
+// reports the queue empty until the producer finishes linking
+void CommandQueue::link(CommandEntry *entry) {
+    entry->next.store(nullptr, std::memory_order_relaxed);
+    CommandEntry *previous = head.exchange(entry);
+    previous->next.store(entry, std::memory_order_release);
+}
+
+// Removes the oldest entry, or returns null if there is none yet
+CommandEntry *CommandQueue::pop() {
+    CommandEntry *first = tail;
+    CommandEntry *next = first->next.load(std::memory_order_acquire);
+    if (first == &stub) {
+        if (next == nullptr) return nullptr;
+        tail = next;
+        first = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next != nullptr) {
+        tail = next;
+        return first;
+    }
+    // first is the last entry: put the stub behind it, so taking it leaves the queue valid
+    if (first != head.load()) return nullptr; // A producer is still linking a newer entry
+    link(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next != nullptr) {
+        tail = next;
+        return first;
+    }
+    return nullptr;
+}
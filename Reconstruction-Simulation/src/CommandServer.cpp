@@ -0,0 +1,260 @@
+#include "CommandServer.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "Memory.h"
+#include "StateView.h"
+#include "Epoch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Rule of 3: copying is deleted, the destructor closes and removes the socket.
+
+namespace {
+
+// How long the acceptor waits for a connection before checking whether to stop
+const int POLL_INTERVAL_MS = 100;
+
+void sendAll(int client, const string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) return;
+        sent += written;
+    }
+}
+
+} // namespace
+
+// Constructor
+CommandServer::Request::Request(BaseAction *action, const string &command, bool logOnly, uint64_t nanos)
+    : action(action), command(command), logOnly(logOnly), nanos(nanos), output(), done(false) {}
+
+// Constructor: binds the socket; clients are accepted once run() starts
+CommandServer::CommandServer(const string &socketPath)
+    : socketPath(socketPath), listenFd(-1), stopping(false), queueLock(), queued(), finished(), requests(), closed(false),
+      clientsLock(), clients(), exited(), clientThreads(), acceptor() {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Command socket path is too long");
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw runtime_error("Unable to create command socket");
+    }
+    unlink(socketPath.c_str()); // A socket left behind by an earlier run
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listenFd, 16) < 0) {
+        ::close(listenFd);
+        throw runtime_error("Unable to open command socket");
+    }
+}
+
+// Destructor
+CommandServer::~CommandServer() {
+    stop();
+    ::close(listenFd);
+    unlink(socketPath.c_str());
+}
+
+// Executor loop: runs queued commands in arrival order until a client closes the simulation
+void CommandServer::run(Simulation &simulation) {
+    simulation.open();
+    simulation.setPublishing(true); // Each command now publishes a StateView before it is answered
+    acceptor = thread(&CommandServer::acceptClients, this);
+
+    while (simulation.isOpen()) {
+        deque<Request*> batch;
+        {
+            std::unique_lock<mutex> lock(queueLock);
+            queued.wait(lock, [this] { return !requests.empty(); });
+            batch.swap(requests);
+        }
+
+        vector<Request*> answered;
+        for (Request *request : batch) {
+            if (request->logOnly) {
+                Stats::recordCommand(request->command, request->nanos, request->action->getStatus() == ActionStatus::ERROR);
+                MemoryScope scope(MemoryTag::ACTIONS_LOG);
+                simulation.addAction(request->action);
+                delete request;
+                continue;
+            }
+            // The executor is the only thread that prints, so its output can be captured per command
+            std::ostringstream output;
+            std::streambuf *console = cout.rdbuf(output.rdbuf());
+            if (!simulation.isOpen()) {
+                delete request->action;
+                cout << "Error: The simulation is closed" << endl;
+            } else {
+                try {
+                    simulation.execute(request->action, request->command);
+                } catch (const exception &e) {
+                    delete request->action;
+                    cout << "Error: " << e.what() << endl;
+                }
+            }
+            cout.rdbuf(console);
+            request->output = output.str();
+            answered.push_back(request);
+        }
+
+        {
+            std::lock_guard<mutex> lock(queueLock);
+            for (Request *request : answered) {
+                request->done = true;
+            }
+        }
+        finished.notify_all();
+    }
+    stop();
+}
+
+// Acceptor thread: starts a thread per client until stopped, joining the ones that ended
+void CommandServer::acceptClients() {
+    while (!stopping.load(std::memory_order_relaxed)) {
+        reapClients();
+        pollfd waiting = {listenFd, POLLIN, 0};
+        if (poll(&waiting, 1, POLL_INTERVAL_MS) <= 0) continue;
+        int client = accept(listenFd, nullptr, nullptr);
+        if (client < 0) continue;
+        {
+            std::lock_guard<mutex> lock(clientsLock);
+            clients.push_back(client);
+        }
+        clientThreads.emplace_back(&CommandServer::serveClient, this, client);
+    }
+}
+
+// Client thread: answers one command per line until the client disconnects or the server stops
+void CommandServer::serveClient(int client) {
+    string pending;
+    char buffer[4096];
+    while (!stopping.load(std::memory_order_relaxed)) {
+        ssize_t received = recv(client, buffer, sizeof(buffer), 0);
+        if (received <= 0) break;
+        pending.append(buffer, received);
+        size_t lineEnd;
+        while ((lineEnd = pending.find('\n')) != string::npos) {
+            string line = pending.substr(0, lineEnd);
+            pending.erase(0, lineEnd + 1);
+            sendAll(client, handle(line));
+        }
+    }
+    std::lock_guard<mutex> lock(clientsLock);
+    clients.erase(std::find(clients.begin(), clients.end(), client));
+    ::close(client);
+    exited.push_back(std::this_thread::get_id());
+}
+
+// Joins the client threads that have ended, so a long-running server doesn't keep one per connection
+void CommandServer::reapClients() {
+    vector<thread::id> ended;
+    {
+        std::lock_guard<mutex> lock(clientsLock);
+        ended.swap(exited);
+    }
+    for (thread::id id : ended) {
+        auto it = std::find_if(clientThreads.begin(), clientThreads.end(),
+                               [id](const thread &clientThread) { return clientThread.get_id() == id; });
+        it->join();
+        clientThreads.erase(it);
+    }
+}
+
+// Runs one command line and returns what it printed
+const string CommandServer::handle(const string &line) {
+    vector<string> args = Auxiliary::parseArguments(line);
+    if (args.empty()) return "";
+    BaseAction *action = nullptr;
+    try {
+        MemoryScope scope(MemoryTag::ACTIONS_LOG);
+        action = Simulation::parseAction(args);
+    } catch (const exception &e) {
+        Stats::add(Stats::PARSE_ERRORS);
+        return string("Error: ") + e.what() + "\n";
+    }
+
+    if (action->isReadOnly()) {
+        std::ostringstream output;
+        uint64_t start = Stats::now();
+        {
+            TraceSpan span(args[0].c_str(), "command");
+            EpochGuard guard;
+            action->answer(*StateView::latest(), output);
+        }
+        // Logged by the executor, in the order it sees it
+        if (!submit(new Request(action, args[0], true, Stats::now() - start))) {
+            return "Error: The simulation is closed\n";
+        }
+        return output.str();
+    }
+
+    Request request(action, args[0], false, 0);
+    if (!submit(&request)) {
+        return "Error: The simulation is closed\n";
+    }
+    std::unique_lock<mutex> lock(queueLock);
+    finished.wait(lock, [&request] { return request.done; });
+    return request.output;
+}
+
+// Queues a request for the executor; returns false (and frees a log-only request) once it has stopped
+bool CommandServer::submit(Request *request) {
+    {
+        std::lock_guard<mutex> lock(queueLock);
+        if (!closed) {
+            requests.push_back(request);
+            queued.notify_one();
+            return true;
+        }
+    }
+    delete request->action;
+    if (request->logOnly) {
+        delete request;
+    }
+    return false;
+}
+
+// Stops taking requests, fails the ones still queued and waits for every client thread
+void CommandServer::stop() {
+    if (stopping.exchange(true)) return;
+    {
+        std::lock_guard<mutex> lock(queueLock);
+        closed = true;
+        for (Request *request : requests) {
+            delete request->action;
+            if (request->logOnly) {
+                delete request;
+            } else {
+                request->output = "Error: The simulation is closed\n";
+                request->done = true;
+            }
+        }
+        requests.clear();
+    }
+    finished.notify_all();
+    if (acceptor.joinable()) {
+        acceptor.join();
+    }
+    {
+        std::lock_guard<mutex> lock(clientsLock);
+        for (int client : clients) {
+            shutdown(client, SHUT_RDWR); // Wakes the client thread blocked in recv
+        }
+    }
+    for (thread &clientThread : clientThreads) {
+        clientThread.join();
+    }
+    clientThreads.clear();
+    exited.clear();
+}
@@ -0,0 +1,143 @@
+#include "Epoch.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+// No rule of 3 needed - all state is static.
+
+// A reader announces the global epoch it entered in, then loads the published pointer.
+// An object retired at epoch e was replaced before the global epoch moved past e, so
+// only readers that announced an epoch <= e can still hold it.
+namespace {
+
+// Only constant-initialized state here, so nothing is destroyed before the last Published<T>
+std::atomic<uint64_t> globalEpoch(1);
+// One cache line per reader, so readers entering and leaving guards don't slow each other down
+struct alignas(64) ReaderSlot {
+    std::atomic<uint64_t> epoch; // 0 while the slot's thread is outside a guard
+    std::atomic<bool> taken;
+};
+
+// The slot table grows a block at a time when every slot is taken. Blocks are never
+// freed, so readers and reclaim() can walk the chain without locks.
+struct SlotBlock {
+    ReaderSlot slots[Epoch::READERS_PER_BLOCK];
+    std::atomic<SlotBlock*> next;
+};
+
+SlotBlock firstBlock;
+
+struct Retired {
+    uint64_t epoch;
+    const void *object;
+    void (*destroy)(const void*);
+    Retired *next;
+};
+
+std::mutex retiredLock; // Taken by writers only
+Retired *retired = nullptr;
+std::atomic<size_t> retiredCount(0);
+
+// Appends a block after the given one, unless another thread just did
+SlotBlock *grow(SlotBlock *block) {
+    void *memory = nullptr;
+    if (posix_memalign(&memory, alignof(SlotBlock), sizeof(SlotBlock)) != 0) {
+        std::abort(); // Readers can't fail, and without a slot a reader isn't safe
+    }
+    SlotBlock *grown = new (memory) SlotBlock();
+    SlotBlock *next = nullptr;
+    if (block->next.compare_exchange_strong(next, grown)) {
+        return grown;
+    }
+    grown->~SlotBlock();
+    free(memory);
+    return next;
+}
+
+ReaderSlot *claimSlot() {
+    for (SlotBlock *block = &firstBlock; ; ) {
+        for (ReaderSlot &slot : block->slots) {
+            bool expected = false;
+            if (!slot.taken.load(std::memory_order_relaxed) && slot.taken.compare_exchange_strong(expected, true)) {
+                return &slot;
+            }
+        }
+        SlotBlock *next = block->next.load();
+        block = next != nullptr ? next : grow(block);
+    }
+}
+
+void releaseSlot(ReaderSlot *slot) {
+    slot->epoch.store(0);
+    slot->taken.store(false);
+}
+
+// Each thread keeps its slot until it exits
+struct ThreadSlot {
+    ThreadSlot() : slot(nullptr), depth(0) {}
+    ThreadSlot(const ThreadSlot &other) = delete;
+    ThreadSlot &operator=(const ThreadSlot &other) = delete;
+    ~ThreadSlot() {
+        if (slot != nullptr) releaseSlot(slot);
+    }
+    ReaderSlot *slot;
+    int depth;
+};
+
+thread_local ThreadSlot threadSlot;
+
+} // namespace
+
+// Hands an object to the reclaimer; it is destroyed once no reader can still hold it
+void Epoch::retire(const void *object, void (*destroy)(const void*)) {
+    std::lock_guard<std::mutex> lock(retiredLock);
+    retired = new Retired{globalEpoch.fetch_add(1), object, destroy, retired};
+    retiredCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Destroys every retired object that no active reader can still hold
+void Epoch::reclaim() {
+    uint64_t oldest = UINT64_MAX;
+    for (SlotBlock *block = &firstBlock; block != nullptr; block = block->next.load()) {
+        for (const ReaderSlot &slot : block->slots) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != 0 && epoch < oldest) oldest = epoch;
+        }
+    }
+    std::lock_guard<std::mutex> lock(retiredLock);
+    Retired **link = &retired;
+    while (*link != nullptr) {
+        Retired *entry = *link;
+        if (entry->epoch < oldest) {
+            *link = entry->next;
+            entry->destroy(entry->object);
+            delete entry;
+            retiredCount.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            link = &entry->next;
+        }
+    }
+}
+
+// Retired objects still waiting for readers
+size_t Epoch::getRetiredCount() {
+    return retiredCount.load(std::memory_order_relaxed);
+}
+
+// Constructor: announces the current epoch (the outermost guard only)
+EpochGuard::EpochGuard() {
+    if (threadSlot.slot == nullptr) {
+        threadSlot.slot = claimSlot();
+    }
+    if (threadSlot.depth++ == 0) {
+        threadSlot.slot->epoch.store(globalEpoch.load());
+    }
+}
+
+// Destructor
+EpochGuard::~EpochGuard() {
+    if (--threadSlot.depth == 0) {
+        threadSlot.slot->epoch.store(0);
+    }
+}
@@ -0,0 +1,169 @@
+#include "FacilityCatalog.h"
+#include "Memory.h"
+
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+// Rule of 3 used in Storage: copying is deleted, the destructor destroys the types and frees the chunks.
+// FacilityCatalog itself is a shared pointer and a count, so the defaults are enough.
+
+namespace {
+
+// Every live store (type-erased, as Storage is private). Appends and lookups hold the
+// lock; reading a version never does.
+std::mutex registryLock;
+vector<std::weak_ptr<void>> registry;
+uint64_t nextStoreId = 1;
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// *************************************************** Storage ******************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor
+FacilityCatalog::Storage::Storage(uint64_t id) : chunks(), count(0), id(id) {}
+
+// Destructor
+FacilityCatalog::Storage::~Storage() {
+    for (size_t i = 0; i < count; i++) {
+        size_t chunk = chunkOf(i);
+        chunks[chunk][i - chunkStart(chunk)].~FacilityType();
+    }
+    for (FacilityType *chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+// Add a type after the last one, allocating its chunk if it starts one
+void FacilityCatalog::Storage::push(const FacilityType &type) {
+    size_t chunk = chunkOf(count);
+    if (chunk >= MAX_CHUNKS) throw std::length_error("Too many facility types");
+    if (chunks[chunk] == nullptr) {
+        MemoryScope scope(MemoryTag::FACILITY_TYPES);
+        chunks[chunk] = static_cast<FacilityType*>(::operator new((FIRST_CHUNK << chunk) * sizeof(FacilityType)));
+    }
+    MemoryScope scope(MemoryTag::FACILITY_TYPES);
+    new (&chunks[chunk][count - chunkStart(chunk)]) FacilityType(type);
+    count++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// *********************************************** FacilityCatalog **************************************************** //
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Constructor: the empty catalog
+FacilityCatalog::FacilityCatalog() : storage(), count(0) {}
+
+FacilityCatalog::FacilityCatalog(const shared_ptr<Storage> &storage, size_t count) : storage(storage), count(count) {}
+
+FacilityCatalog::const_iterator FacilityCatalog::begin() const {
+    return const_iterator(*this, 0);
+}
+
+FacilityCatalog::const_iterator FacilityCatalog::end() const {
+    return const_iterator(*this, count);
+}
+
+// Check if a type of facility is in this version, scanning chunk by chunk
+bool FacilityCatalog::contains(const string &name) const {
+    for (size_t chunk = 0; chunk < MAX_CHUNKS && chunkStart(chunk) < count; chunk++) {
+        size_t length = min(FIRST_CHUNK << chunk, count - chunkStart(chunk));
+        const FacilityType *types = storage->chunks[chunk];
+        for (size_t i = 0; i < length; i++) {
+            if (types[i].getName() == name) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Whether both are the same types from the same store
+bool FacilityCatalog::isSameVersion(const FacilityCatalog &other) const {
+    return storage == other.storage && count == other.count;
+}
+
+// Whether both are versions of one store
+bool FacilityCatalog::isSameStore(const FacilityCatalog &other) const {
+    return storage == other.storage;
+}
+
+// Identifies the store (0 for the empty catalog)
+uint64_t FacilityCatalog::getStoreId() const {
+    return storage ? storage->id : 0;
+}
+
+// Move to the version with one more type at the end
+void FacilityCatalog::append(const FacilityType &type) {
+    std::lock_guard<std::mutex> guard(registryLock);
+    if (storage && storage->count == count) {
+        // The newest version: readers of this and older versions never look past count
+        storage->push(type);
+        count++;
+        return;
+    }
+    if (storage && sameType((*this)[count], type)) {
+        // Someone else already appended this type here
+        count++;
+        return;
+    }
+    vector<FacilityType> types;
+    types.reserve(count + 1);
+    for (const FacilityType &existing : *this) {
+        types.push_back(existing);
+    }
+    types.push_back(type);
+    FacilityCatalog live = find(types);
+    *this = live.storage ? live : create(types);
+}
+
+// A version of a live store that starts with exactly these types, or a new store
+FacilityCatalog FacilityCatalog::intern(const vector<FacilityType> &types) {
+    if (types.empty()) return FacilityCatalog();
+    std::lock_guard<std::mutex> guard(registryLock);
+    FacilityCatalog live = find(types);
+    return live.storage ? live : create(types);
+}
+
+// A version of a live store with these types, or the empty catalog. Called with the registry lock held.
+FacilityCatalog FacilityCatalog::find(const vector<FacilityType> &types) {
+    for (auto it = registry.begin(); it != registry.end();) {
+        shared_ptr<Storage> live = std::static_pointer_cast<Storage>(it->lock());
+        if (!live) {
+            it = registry.erase(it);
+            continue;
+        }
+        ++it;
+        if (live->count < types.size()) continue;
+        FacilityCatalog candidate(live, types.size());
+        bool same = true;
+        for (size_t i = 0; same && i < types.size(); i++) {
+            same = sameType(candidate[i], types[i]);
+        }
+        if (same) return candidate;
+    }
+    return FacilityCatalog();
+}
+
+// A new store with these types. Called with the registry lock held.
+FacilityCatalog FacilityCatalog::create(const vector<FacilityType> &types) {
+    shared_ptr<Storage> storage;
+    {
+        MemoryScope scope(MemoryTag::FACILITY_TYPES);
+        storage = std::make_shared<Storage>(nextStoreId++);
+    }
+    for (const FacilityType &type : types) {
+        storage->push(type);
+    }
+    registry.push_back(storage);
+    return FacilityCatalog(storage, types.size());
+}
+
+bool FacilityCatalog::sameType(const FacilityType &a, const FacilityType &b) {
+    return a.getName() == b.getName() && a.getCategory() == b.getCategory() && a.getCost() == b.getCost() &&
+           a.getLifeQualityScore() == b.getLifeQualityScore() && a.getEconomyScore() == b.getEconomyScore() &&
+           a.getEnvironmentScore() == b.getEnvironmentScore();
+}
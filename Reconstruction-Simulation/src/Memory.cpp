@@ -0,0 +1,253 @@
+#include "Memory.h"
+#include "Facility.h"
+#include "SelectionPolicy.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+
+// No rule of 3 needed - all state is static.
+
+namespace {
+
+// Placed in front of every block; 16 bytes, so the block keeps malloc's alignment
+struct BlockHeader {
+    uint64_t size;
+    uint32_t tag;
+    uint32_t magic;
+};
+
+const uint32_t BLOCK_MAGIC = 0x4d454d54; // "MEMT"
+
+// Mixed with the block's address, so a pointer into some other block is unlikely to pass for a header
+uint32_t magicOf(const BlockHeader *header) {
+    return BLOCK_MAGIC ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(header) >> 4);
+}
+
+// One thread's counts. Only the thread that holds them writes them, with a plain load and
+// store; the atomics just keep the readers' loads whole. They are deltas: a block freed on
+// another thread is subtracted there, so only the sum over all threads means anything.
+struct Counters {
+    std::atomic<uint64_t> bytes[Memory::NUM_OF_TAGS];
+    std::atomic<uint64_t> blocks[Memory::NUM_OF_TAGS];
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> allocatedBytes;
+    std::atomic<bool> taken;
+    Counters *next;
+};
+
+// Zero-initialized before any dynamic initialization, so the first allocations are counted too.
+// Counters are never freed; a thread that exits hands its counters to the next new thread.
+std::atomic<Counters*> allCounters(nullptr);
+Counters shared; // Used, with read-modify-writes, by threads whose counters were already handed back
+thread_local Counters *localCounters = nullptr;
+thread_local bool exited = false;
+thread_local MemoryTag currentTag = MemoryTag::OTHER;
+
+const char *TAG_NAMES[] = {"other", "plans", "facilitiesUnderConstruction", "facilitiesOperational", "settlements",
+                           "facilityTypes", "policies", "actionsLog", "snapshots"};
+
+// Takes counters an exited thread left behind, or adds new ones
+Counters *claimCounters() {
+    for (Counters *counters = allCounters.load(std::memory_order_acquire); counters != nullptr; counters = counters->next) {
+        bool expected = false;
+        if (!counters->taken.load(std::memory_order_relaxed) &&
+            counters->taken.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return counters;
+        }
+    }
+    void *memory = calloc(1, sizeof(Counters)); // Not operator new, which would count into them
+    if (memory == nullptr) return nullptr;
+    Counters *counters = new (memory) Counters();
+    counters->taken.store(true, std::memory_order_relaxed);
+    Counters *head = allCounters.load(std::memory_order_relaxed);
+    do {
+        counters->next = head;
+    } while (!allCounters.compare_exchange_weak(head, counters, std::memory_order_release, std::memory_order_relaxed));
+    return counters;
+}
+
+// Hands the thread's counters back when it exits
+struct CountersRelease {
+    ~CountersRelease() {
+        localCounters->taken.store(false, std::memory_order_release);
+        localCounters = nullptr;
+        exited = true;
+    }
+};
+
+// The calling thread's counters, or null once it has handed them back
+Counters *threadCounters() {
+    if (localCounters == nullptr && !exited) {
+        localCounters = claimCounters();
+        if (localCounters != nullptr) {
+            static thread_local CountersRelease release;
+        }
+    }
+    return localCounters;
+}
+
+// The calling thread's counters are only written by it, so a load and a store are enough
+void add(std::atomic<uint64_t> &counter, uint64_t amount, bool owned) {
+    if (owned) {
+        counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    } else {
+        counter.fetch_add(amount, std::memory_order_relaxed);
+    }
+}
+
+// Amounts wrap around, so adding sign * size subtracts when sign is -1
+void account(uint32_t tag, uint64_t size, int sign) {
+    Counters *counters = threadCounters();
+    Counters &target = counters != nullptr ? *counters : shared;
+    uint64_t amount = static_cast<uint64_t>(static_cast<int64_t>(sign));
+    add(target.bytes[tag], amount * size, counters != nullptr);
+    add(target.blocks[tag], amount, counters != nullptr);
+}
+
+// Sum of one counter over every thread
+template <class Field>
+uint64_t sum(Field field) {
+    uint64_t total = field(shared).load(std::memory_order_relaxed);
+    for (Counters *counters = allCounters.load(std::memory_order_acquire); counters != nullptr; counters = counters->next) {
+        total += field(*counters).load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void *allocate(size_t size) noexcept {
+    Counters *counters = threadCounters();
+    Counters &target = counters != nullptr ? *counters : shared;
+    add(target.allocations, 1, counters != nullptr);
+    add(target.allocatedBytes, size, counters != nullptr);
+    BlockHeader *header = static_cast<BlockHeader*>(malloc(sizeof(BlockHeader) + size));
+    if (header == nullptr) return nullptr;
+    header->size = size;
+    header->tag = static_cast<uint32_t>(currentTag);
+    header->magic = magicOf(header);
+    account(header->tag, size, 1);
+    return header + 1;
+}
+
+void deallocate(void *block) noexcept {
+    if (block == nullptr) return;
+    BlockHeader *header = static_cast<BlockHeader*>(block) - 1;
+    account(header->tag, header->size, -1);
+    header->magic = 0;
+    free(header);
+}
+
+// Moves a block from operator new to another tag
+void retagBlock(const void *block, MemoryTag tag) {
+    if (block == nullptr) return;
+    BlockHeader *header = const_cast<BlockHeader*>(static_cast<const BlockHeader*>(block) - 1);
+    if (header->magic != magicOf(header)) return;
+    account(header->tag, header->size, -1);
+    header->tag = static_cast<uint32_t>(tag);
+    account(header->tag, header->size, 1);
+}
+
+// Moves a string's buffer to another tag, unless the string keeps its characters inline
+void retagString(const string &str, MemoryTag tag) {
+    const char *data = str.data();
+    const char *inlineStart = reinterpret_cast<const char*>(&str);
+    if (str.empty() || (data >= inlineStart && data < inlineStart + sizeof(string))) return;
+    retagBlock(data, tag);
+}
+
+} // namespace
+
+// Every allocation goes through these, so allocations are counted exactly.
+// All forms are replaced so that each one pairs with the matching delete.
+void *operator new(size_t size) {
+    void *block = allocate(size);
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    return block;
+}
+
+void *operator new[](size_t size) {
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void *block) noexcept {
+    deallocate(block);
+}
+
+void operator delete[](void *block) noexcept {
+    deallocate(block);
+}
+
+void operator delete(void *block, const std::nothrow_t&) noexcept {
+    deallocate(block);
+}
+
+void operator delete[](void *block, const std::nothrow_t&) noexcept {
+    deallocate(block);
+}
+
+// Moves a facility and its name buffers to another tag (e.g. when it becomes operational)
+void Memory::retag(const Facility *facility, MemoryTag tag) {
+    retagBlock(facility, tag);
+    retagString(facility->getName(), tag);
+    retagString(facility->getSettlementName(), tag);
+}
+
+void Memory::retag(const SelectionPolicy *policy, MemoryTag tag) {
+    retagBlock(policy, tag);
+}
+
+uint64_t Memory::getBytes(MemoryTag tag) {
+    return sum([tag](const Counters &counters) -> const std::atomic<uint64_t>& { return counters.bytes[static_cast<int>(tag)]; });
+}
+
+uint64_t Memory::getBlocks(MemoryTag tag) {
+    return sum([tag](const Counters &counters) -> const std::atomic<uint64_t>& { return counters.blocks[static_cast<int>(tag)]; });
+}
+
+uint64_t Memory::getAllocations() {
+    return sum([](const Counters &counters) -> const std::atomic<uint64_t>& { return counters.allocations; });
+}
+
+uint64_t Memory::getAllocatedBytes() {
+    return sum([](const Counters &counters) -> const std::atomic<uint64_t>& { return counters.allocatedBytes; });
+}
+
+const char *Memory::tagName(MemoryTag tag) {
+    return TAG_NAMES[static_cast<int>(tag)];
+}
+
+// Report printed by the mem command
+const string Memory::toString() {
+    std::ostringstream oss;
+    uint64_t totalBytes = 0;
+    uint64_t totalBlocks = 0;
+    for (int tag = 0; tag < NUM_OF_TAGS; tag++) {
+        MemoryTag memoryTag = static_cast<MemoryTag>(tag);
+        oss << "Subsystem: " << tagName(memoryTag) << " Blocks: " << getBlocks(memoryTag) << " Bytes: " << getBytes(memoryTag) << "\n";
+        totalBytes += getBytes(memoryTag);
+        totalBlocks += getBlocks(memoryTag);
+    }
+    oss << "Total: Blocks: " << totalBlocks << " Bytes: " << totalBytes << "\n";
+    return oss.str();
+}
+
+// Constructor: makes the tag current for this thread
+MemoryScope::MemoryScope(MemoryTag tag) : previous(currentTag) {
+    currentTag = tag;
+}
+
+// Destructor: restores the enclosing scope's tag
+MemoryScope::~MemoryScope() {
+    currentTag = previous;
+}
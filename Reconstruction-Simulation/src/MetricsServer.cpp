@@ -0,0 +1,180 @@
+#include "MetricsServer.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Stats.h"
+
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Rule of 3: copying is deleted, the destructor stops the thread and removes the socket.
+
+namespace {
+
+enum Gauge {
+    TICK,
+    PLANS,
+    SETTLEMENTS,
+    FACILITY_TYPES,
+    OPERATIONAL_FACILITIES,
+    UNDER_CONSTRUCTION_FACILITIES,
+    LOGGED_ACTIONS,
+    SNAPSHOT_STORED_BYTES,
+    NUM_OF_GAUGES
+};
+
+atomic<bool> serving(false);
+atomic<uint64_t> gauges[NUM_OF_GAUGES];
+
+// How long the server thread waits for a connection before checking whether to stop
+const int POLL_INTERVAL_MS = 100;
+
+// Histogram buckets reported to Prometheus: 1us to 17s
+const int FIRST_BUCKET = 9;
+const int LAST_BUCKET = 33;
+
+void writeGauge(std::ostringstream &out, const char *name, const char *help, const char *type, uint64_t value) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+    out << name << " " << value << "\n";
+}
+
+// Resident set size from /proc, or 0 where unavailable
+uint64_t residentBytes() {
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == nullptr) return 0;
+    unsigned long size = 0, resident = 0;
+    int read = fscanf(statm, "%lu %lu", &size, &resident);
+    fclose(statm);
+    return read == 2 ? static_cast<uint64_t>(resident) * sysconf(_SC_PAGESIZE) : 0;
+}
+
+} // namespace
+
+// Constructor: binds the socket and starts the server thread
+MetricsServer::MetricsServer(const string &socketPath) : socketPath(socketPath), listenFd(-1), stopping(false), worker() {
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw runtime_error("Metrics socket path is too long");
+    }
+    strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw runtime_error("Unable to create metrics socket");
+    }
+    unlink(socketPath.c_str()); // A socket left behind by an earlier run
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listenFd, 8) < 0) {
+        ::close(listenFd);
+        throw runtime_error("Unable to open metrics socket");
+    }
+    serving.store(true, std::memory_order_relaxed);
+    worker = thread(&MetricsServer::run, this);
+}
+
+// Destructor
+MetricsServer::~MetricsServer() {
+    serving.store(false, std::memory_order_relaxed);
+    stopping.store(true, std::memory_order_relaxed);
+    worker.join();
+    ::close(listenFd);
+    unlink(socketPath.c_str());
+}
+
+// Copies the simulation's gauges for the server thread; a no-op unless a server is running
+void MetricsServer::publish(const Simulation &simulation) {
+    if (!serving.load(std::memory_order_relaxed)) return;
+    const PlanViews &views = simulation.getViews(); // Kept up to date as plans change, so no scan here
+    gauges[TICK].store(simulation.getTick(), std::memory_order_relaxed);
+    gauges[PLANS].store(simulation.getPlans().size(), std::memory_order_relaxed);
+    gauges[SETTLEMENTS].store(simulation.getSettlementCount(), std::memory_order_relaxed);
+    gauges[FACILITY_TYPES].store(simulation.getFacilityTypeCount(), std::memory_order_relaxed);
+    gauges[OPERATIONAL_FACILITIES].store(views.getOperationalFacilities(), std::memory_order_relaxed);
+    gauges[UNDER_CONSTRUCTION_FACILITIES].store(views.getFacilitiesUnderConstruction(), std::memory_order_relaxed);
+    gauges[LOGGED_ACTIONS].store(simulation.getActionsLog().size(), std::memory_order_relaxed);
+    gauges[SNAPSHOT_STORED_BYTES].store(snapshots == nullptr ? 0 : snapshots->getStoredBytes(), std::memory_order_relaxed);
+}
+
+// Renders all metrics in the Prometheus text exposition format
+const string MetricsServer::render() {
+    std::ostringstream out;
+    writeGauge(out, "simulation_tick", "Steps simulated so far.", "gauge", gauges[TICK].load(std::memory_order_relaxed));
+    writeGauge(out, "simulation_plans", "Number of plans.", "gauge", gauges[PLANS].load(std::memory_order_relaxed));
+    writeGauge(out, "simulation_settlements", "Number of settlements.", "gauge", gauges[SETTLEMENTS].load(std::memory_order_relaxed));
+    writeGauge(out, "simulation_facility_types", "Number of facility types.", "gauge", gauges[FACILITY_TYPES].load(std::memory_order_relaxed));
+    out << "# HELP simulation_facilities Facilities of all plans by status.\n";
+    out << "# TYPE simulation_facilities gauge\n";
+    out << "simulation_facilities{status=\"operational\"} " << gauges[OPERATIONAL_FACILITIES].load(std::memory_order_relaxed) << "\n";
+    out << "simulation_facilities{status=\"under_construction\"} " << gauges[UNDER_CONSTRUCTION_FACILITIES].load(std::memory_order_relaxed) << "\n";
+    writeGauge(out, "simulation_logged_actions", "Entries in the action log.", "gauge", gauges[LOGGED_ACTIONS].load(std::memory_order_relaxed));
+    writeGauge(out, "simulation_snapshot_stored_bytes", "Bytes held by stored snapshots.", "gauge", gauges[SNAPSHOT_STORED_BYTES].load(std::memory_order_relaxed));
+    writeGauge(out, "simulation_resident_memory_bytes", "Resident set size of the process.", "gauge", residentBytes());
+    writeGauge(out, "simulation_steps_total", "Simulation steps executed.", "counter", Stats::get(Stats::STEPS));
+    writeGauge(out, "simulation_parse_errors_total", "Commands that could not be parsed.", "counter", Stats::get(Stats::PARSE_ERRORS));
+
+    const LatencyHistogram &steps = Stats::getStepLatency();
+    out << "# HELP simulation_step_duration_seconds Duration of a simulation step.\n";
+    out << "# TYPE simulation_step_duration_seconds histogram\n";
+    uint64_t cumulative = 0;
+    for (int bucket = 0; bucket < LatencyHistogram::NUM_OF_BUCKETS; bucket++) {
+        cumulative += steps.getBucket(bucket);
+        if (bucket >= FIRST_BUCKET && bucket <= LAST_BUCKET) {
+            out << "simulation_step_duration_seconds_bucket{le=\"" << LatencyHistogram::bucketLimit(bucket) / 1e9 << "\"} " << cumulative << "\n";
+        }
+    }
+    out << "simulation_step_duration_seconds_bucket{le=\"+Inf\"} " << cumulative << "\n";
+    out << "simulation_step_duration_seconds_sum " << steps.getSum() / 1e9 << "\n";
+    out << "simulation_step_duration_seconds_count " << cumulative << "\n";
+
+    out << "# HELP simulation_commands_total Commands executed by type.\n";
+    out << "# TYPE simulation_commands_total counter\n";
+    Stats::forEachCommand([&out](const Stats::CommandStats &stats) {
+        out << "simulation_commands_total{command=\"" << stats.name << "\"} " << stats.latency.getCount() << "\n";
+    });
+    out << "# HELP simulation_command_errors_total Commands that ended in an error by type.\n";
+    out << "# TYPE simulation_command_errors_total counter\n";
+    Stats::forEachCommand([&out](const Stats::CommandStats &stats) {
+        out << "simulation_command_errors_total{command=\"" << stats.name << "\"} " << stats.errors.load(std::memory_order_relaxed) << "\n";
+    });
+    return out.str();
+}
+
+// Server thread: answers one connection at a time until stopped
+void MetricsServer::run() {
+    while (!stopping.load(std::memory_order_relaxed)) {
+        pollfd waiting = {listenFd, POLLIN, 0};
+        if (poll(&waiting, 1, POLL_INTERVAL_MS) <= 0) continue;
+        int client = accept(listenFd, nullptr, nullptr);
+        if (client < 0) continue;
+        serve(client);
+        ::close(client);
+    }
+}
+
+// Reads the request (its content does not matter) and writes the metrics as an HTTP response
+void MetricsServer::serve(int client) const {
+    char request[1024];
+    pollfd readable = {client, POLLIN, 0};
+    if (poll(&readable, 1, POLL_INTERVAL_MS) > 0) {
+        ssize_t ignored = recv(client, request, sizeof(request), 0);
+        (void)ignored;
+    }
+    const string body = render();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n\r\n"
+             << body;
+    const string data = response.str();
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) break;
+        sent += written;
+    }
+}
@@ -1,61 +1,97 @@
 #include "Plan.h"
+#include "Trace.h"
+#include "Memory.h"
 
 // Rule of 5 used here, Class contains resources.
  // But without Assignment operator= and Move Assigment operator=
 
 
 // Constructor
-Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions)
+Plan::Plan(const int planId, const size_t settlementId, const vector<Settlement*> &settlements, SelectionPolicy *selectionPolicy, const FacilityCatalog &facilityOptions)
     : plan_id(planId),
-      settlement(settlement),
+      settlementId(settlementId),
+      settlements(&settlements),
       selectionPolicy(selectionPolicy),
       status(PlanStatus::AVALIABLE),
       facilities(),
       underConstruction(),
-      facilityOptions(facilityOptions),
+      facilityOptions(&facilityOptions),
       life_quality_score(0),
       economy_score(0),
-      environment_score(0)
+      environment_score(0),
+      tick(1),
+      logStart(0),
+      changes(),
+      reported(NOT_REPORTED),
+      revision(0),
+      renderedFacilities(),
+      renderedCount(0)
       {
+    Memory::retag(selectionPolicy, MemoryTag::POLICIES);
 }
 
 // Copy Constructor
 Plan::Plan(const Plan &other)
+    : Plan(other, *other.settlements, *other.facilityOptions) { // References the same tables.
+}
+
+// Copy Constructor that binds the copy to another simulation's tables.
+// Settlements are referenced by index, so no lookup by name is needed.
+Plan::Plan(const Plan &other, const vector<Settlement*> &settlements, const FacilityCatalog &facilityOptions)
     : plan_id(other.plan_id),
-      settlement(other.settlement), // References the same settlement object.
+      settlementId(other.settlementId),
+      settlements(&settlements),
       selectionPolicy(other.selectionPolicy->clone()), // Deep copy of selection policy.
       status(other.status),
       facilities(),
       underConstruction(),
-      facilityOptions(other.facilityOptions), // References the same facility options.
+      facilityOptions(&facilityOptions),
       life_quality_score(other.life_quality_score),
       economy_score(other.economy_score),
-      environment_score(other.environment_score)
+      environment_score(other.environment_score),
+      tick(other.tick),
+      logStart(other.tick), // The history stays with the original
+      changes(),
+      reported(NOT_REPORTED),
+      revision(0),
+      renderedFacilities(), // Rendered again on demand
+      renderedCount(0)
     {
+    Memory::retag(selectionPolicy, MemoryTag::POLICIES);
 
     // Deep copy facilities
     for (Facility* facility : other.facilities) {
         facilities.push_back(new Facility(*facility));
+        Memory::retag(facilities.back(), MemoryTag::FACILITIES_OPERATIONAL);
     }
 
     // Deep copy under-construction facilities
     for (Facility* facility : other.underConstruction) {
         underConstruction.push_back(new Facility(*facility));
+        Memory::retag(underConstruction.back(), MemoryTag::FACILITIES_UNDER_CONSTRUCTION);
     }
 }
 
 // Move Constructor
 Plan::Plan(Plan &&other) noexcept
     : plan_id(other.plan_id),
-      settlement(other.settlement),
+      settlementId(other.settlementId),
+      settlements(other.settlements),
       selectionPolicy(other.selectionPolicy),
       status(other.status),
       facilities(move(other.facilities)),   // Transfers ownership
       underConstruction(move(other.underConstruction)),   // Transfers ownership
-      facilityOptions(move(other.facilityOptions)), // References the same facility options.
+      facilityOptions(other.facilityOptions), // References the same facility options.
       life_quality_score(other.life_quality_score),
       economy_score(other.economy_score),
-      environment_score(other.environment_score) {
+      environment_score(other.environment_score),
+      tick(other.tick),
+      logStart(other.logStart),
+      changes(move(other.changes)),
+      reported(other.reported),
+      revision(other.revision),
+      renderedFacilities(move(other.renderedFacilities)),
+      renderedCount(other.renderedCount) {
 
     // Reset pointers from the source object to ensure no double free
     other.selectionPolicy = nullptr;
@@ -72,6 +108,51 @@ Plan::~Plan() {
     }
 }
 
+// Exchanges the full state of two plans (used to commit a fork back into its plan)
+void Plan::swap(Plan &other) noexcept {
+    std::swap(plan_id, other.plan_id);
+    std::swap(settlementId, other.settlementId);
+    std::swap(settlements, other.settlements);
+    std::swap(selectionPolicy, other.selectionPolicy);
+    std::swap(status, other.status);
+    facilities.swap(other.facilities);
+    underConstruction.swap(other.underConstruction);
+    std::swap(facilityOptions, other.facilityOptions);
+    std::swap(life_quality_score, other.life_quality_score);
+    std::swap(economy_score, other.economy_score);
+    std::swap(environment_score, other.environment_score);
+    std::swap(tick, other.tick);
+    std::swap(logStart, other.logStart);
+    changes.swap(other.changes);
+    std::swap(reported, other.reported);
+    std::swap(revision, other.revision);
+    renderedFacilities.swap(other.renderedFacilities);
+    std::swap(renderedCount, other.renderedCount);
+}
+
+// Take over a fork's state and append its changes to this plan's log; the fork gets
+// this plan's old state. Changes the fork made ahead of this plan's tick (or before its
+// newest change) are tagged with the nearest tick that keeps the log in tick order.
+void Plan::adopt(Plan &fork) {
+    std::swap(selectionPolicy, fork.selectionPolicy);
+    std::swap(status, fork.status);
+    facilities.swap(fork.facilities);
+    underConstruction.swap(fork.underConstruction);
+    std::swap(life_quality_score, fork.life_quality_score);
+    std::swap(economy_score, fork.economy_score);
+    std::swap(environment_score, fork.environment_score);
+    renderedFacilities.swap(fork.renderedFacilities);
+    std::swap(renderedCount, fork.renderedCount);
+    int lowest = changes.empty() ? logStart : changes.back().tick;
+    for (const PlanChange &change : fork.changes) {
+        int changeTick = max(lowest, min(change.tick, tick));
+        changes.emplace_back(changeTick, change.kind, change.detail);
+        lowest = changeTick;
+    }
+    fork.changes.clear();
+    revision++;
+}
+
 // Field's getters and setters
 const int Plan::getPlanId() const {
     return plan_id;
@@ -89,12 +170,26 @@ const int Plan::getEnvironmentScore() const {
     return environment_score;
 }
 
+PlanStatus Plan::getStatus() const {
+    return status;
+}
+
 SelectionPolicy* Plan::getSelectionPolicy() const {
     return selectionPolicy;
 }
 
 const Settlement& Plan::getSettlement() const {
-    return settlement; 
+    return *(*settlements)[settlementId];
+}
+
+size_t Plan::getSettlementId() const {
+    return settlementId;
+}
+
+// Points the plan at new settlement and facility tables (used when its simulation moves).
+void Plan::bindTables(const vector<Settlement*> &newSettlements, const FacilityCatalog &newFacilityOptions) {
+    settlements = &newSettlements;
+    facilityOptions = &newFacilityOptions;
 }
 
 const vector<Facility *> &Plan::getFacilities() const {
@@ -110,11 +205,38 @@ void Plan::setSelectionPolicy(SelectionPolicy *newSelectionPolicy) {
         delete selectionPolicy;  // Clean up old policy
     }
     selectionPolicy = newSelectionPolicy; 
+    Memory::retag(selectionPolicy, MemoryTag::POLICIES);
+    recordChange(PlanChange::POLICY, selectionPolicy->toString());
+}
+
+// Creates a selection policy by name, or returns nullptr for an unknown name.
+// A balanced policy starts from the plan's current and under-construction scores.
+SelectionPolicy *Plan::createPolicy(const string &policyName) const {
+    if (policyName == "eco") {
+        return new EconomySelection();
+    } else if (policyName == "bal") {
+        int lifeQualityScore = life_quality_score;
+        int economyScore = economy_score;
+        int environmentScore = environment_score;
+        for (const Facility *facility : underConstruction) {
+            lifeQualityScore += facility->getLifeQualityScore();
+            economyScore += facility->getEconomyScore();
+            environmentScore += facility->getEnvironmentScore();
+        }
+        return new BalancedSelection(lifeQualityScore, economyScore, environmentScore);
+    } else if (policyName == "sus") {
+        return new SustainabilitySelection();
+    } else if (policyName == "nve") {
+        return new NaiveSelection();
+    }
+    return nullptr;
 }
 
 // Executes a single step of the plan, managing facility construction and scores.
-void Plan::step() {
-    size_t capacity;
+PlanStepCounts Plan::step() {
+    const Settlement &settlement = getSettlement();
+    size_t capacity = 0;
+    PlanStepCounts counts = {0, 0};
     // Determines the facility capacity based on the settlement type.
     switch (settlement.getType()) {
         case SettlementType::VILLAGE:    capacity = 1; break;
@@ -122,18 +244,28 @@ void Plan::step() {
         case SettlementType::METROPOLIS: capacity = 3; break;
     }
     // Adds new facilities to under-construction if there's capacity and available options.
-    while (capacity > underConstruction.size() && facilityOptions.size() != 0)  {  
-        FacilityType nextType = selectionPolicy->selectFacility(facilityOptions);
-        Facility* nextFacility = new Facility(nextType, settlement.getName());
-        addFacility(nextFacility);
+    {
+        TraceSpan span("select", "plan", plan_id);
+        while (capacity > underConstruction.size() && facilityOptions->size() != 0)  {  
+            FacilityType nextType = selectionPolicy->selectFacility(*facilityOptions);
+            Facility* nextFacility = new Facility(nextType, settlement.getName());
+            Memory::retag(nextFacility, MemoryTag::FACILITIES_UNDER_CONSTRUCTION);
+            addFacility(nextFacility);
+            recordChange(PlanChange::FACILITY_STARTED, nextFacility->getName());
+            counts.started++;
+        }
     }
     
     // Process under-construction facilities
+    TraceSpan span("construct", "plan", plan_id);
     for (size_t i = 0; i < underConstruction.size(); ) {
         Facility *facility = underConstruction[i];
         facility->step(); 
         if (facility->getStatus() == FacilityStatus::OPERATIONAL) {
             addFacility(facility);
+            Memory::retag(facility, MemoryTag::FACILITIES_OPERATIONAL);
+            recordChange(PlanChange::FACILITY_COMPLETED, facility->getName());
+            counts.completed++;
             life_quality_score += facility->getLifeQualityScore();
             economy_score += facility->getEconomyScore();
             environment_score += facility->getEnvironmentScore();
@@ -143,11 +275,20 @@ void Plan::step() {
         }
     }
 
+    if (counts.completed > 0) {
+        recordChange(PlanChange::SCORES, to_string(life_quality_score) + " " + to_string(economy_score) + " " + to_string(environment_score));
+    }
+
+    PlanStatus previousStatus = status;
     if (underConstruction.size() == capacity) {
         status = PlanStatus::BUSY;
     } else {
         status = PlanStatus::AVALIABLE;
     }
+    if (status != previousStatus) {
+        recordChange(PlanChange::STATUS, status == PlanStatus::AVALIABLE ? "AVAILABLE" : "BUSY");
+    }
+    return counts;
 }
 
 // Adds a facility to either the operational or under-construction list.
@@ -173,7 +314,7 @@ const string Plan::toString() const {
     std::ostringstream output;
 
     output << "PlanID: " << plan_id << "\n";
-    output << "SettlementName: " << settlement.getName() << "\n";
+    output << "SettlementName: " << getSettlement().getName() << "\n";
     output << "PlanStatus: " << (status == PlanStatus::AVALIABLE ? "AVAILABLE" : "BUSY") << "\n";
     output << "SelectionPolicy: " << selectionPolicy->toString() << "\n";
     output << "LifeQualityScore: " << life_quality_score << "\n";
@@ -185,10 +326,125 @@ const string Plan::toString() const {
         output << "FacilityStatus: UNDER_CONSTRUCTION\n";
     }
 
-    for (const auto &facility : facilities) {
-        output << "FacilityName: " << facility->getName() << "\n";
-        output << "FacilityStatus: OPERATIONAL\n";
+    // Only facilities that completed since the last call are formatted
+    for (; renderedCount < facilities.size(); renderedCount++) {
+        renderedFacilities += "FacilityName: ";
+        renderedFacilities += facilities[renderedCount]->getName();
+        renderedFacilities += "\nFacilityStatus: OPERATIONAL\n";
+    }
+
+    string result = output.str();
+    result += renderedFacilities;
+    return result;
+}
+
+// Hash of everything that determines the plan's future: scores, status, policy state
+// and the facilities under construction. Operational facilities only matter through the scores.
+size_t Plan::hashState() const {
+    size_t seed = selectionPolicy->hashState();
+    for (int value : {life_quality_score, economy_score, environment_score, static_cast<int>(status)}) {
+        seed = seed * 31 + hash<int>()(value);
+    }
+    for (const Facility *facility : underConstruction) {
+        seed = seed * 31 + hash<string>()(facility->getName());
+        seed = seed * 31 + hash<int>()(facility->getTimeLeft());
     }
+    return seed;
+}
 
+// Whether the other plan is in the same state as far as hashState() looks, so both have the same future
+bool Plan::isSameState(const Plan &other) const {
+    if (life_quality_score != other.life_quality_score || economy_score != other.economy_score ||
+        environment_score != other.environment_score || status != other.status ||
+        underConstruction.size() != other.underConstruction.size() ||
+        !selectionPolicy->isSameState(*other.selectionPolicy)) {
+        return false;
+    }
+    for (size_t i = 0; i < underConstruction.size(); i++) {
+        if (underConstruction[i]->getName() != other.underConstruction[i]->getName() ||
+            underConstruction[i]->getTimeLeft() != other.underConstruction[i]->getTimeLeft()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Starts an empty log at the current tick; changes from now on are tagged with the next one
+void Plan::startChangeLog(int startTick) {
+    tick = startTick + 1;
+    logStart = startTick;
+    changes.clear();
+    reported = NOT_REPORTED;
+}
+
+// Sets the tick that the following changes are tagged with
+void Plan::setTick(int newTick) {
+    tick = newTick;
+}
+
+size_t Plan::getRevision() const {
+    return revision;
+}
+
+int Plan::getTick() const {
+    return tick;
+}
+
+int Plan::getLogStart() const {
+    return logStart;
+}
+
+// Index of the first change tagged at or after the tick (changes are in tick order)
+size_t Plan::findChanges(int since) const {
+    auto first = lower_bound(changes.begin(), changes.end(), since,
+                             [](const PlanChange &change, int value) { return change.tick < value; });
+    return first - changes.begin();
+}
+
+// Returns the changes from the index on, one line each
+const string Plan::changesToString(size_t from) const {
+    static const char *KIND_NAMES[] = {"FacilityStarted", "FacilityCompleted", "Scores", "PlanStatus", "SelectionPolicy"};
+    std::ostringstream output;
+    output << "PlanID: " << plan_id << "\n";
+    output << "Changes: " << changes.size() - from << "\n";
+    for (size_t i = from; i < changes.size(); i++) {
+        output << "Tick: " << changes[i].tick << " " << KIND_NAMES[changes[i].kind] << ": " << changes[i].detail << "\n";
+    }
     return output.str();
 }
+
+size_t Plan::getReported() const {
+    return reported;
+}
+
+// The subscriber has now seen every change so far
+void Plan::markReported() {
+    reported = changes.size();
+}
+
+void Plan::recordChange(PlanChange::Kind kind, const string &detail) {
+    changes.emplace_back(tick, kind, detail);
+    revision++;
+    if (changes.size() > MAX_CHANGES) {
+        trimChanges();
+    }
+}
+
+// Drops the oldest changes down to half the bound, but only ones the subscriber has already
+// seen, unless the log reached twice the bound. Whole ticks are dropped, so the log still
+// holds every change from logStart on; a subscriber that falls behind gets the full status.
+void Plan::trimChanges() {
+    size_t drop = changes.size() - MAX_CHANGES / 2;
+    if (reported != NOT_REPORTED && reported < drop && changes.size() < 2 * MAX_CHANGES) {
+        drop = reported;
+    }
+    while (drop > 0 && drop < changes.size() && changes[drop].tick == changes[drop - 1].tick) {
+        drop++;
+    }
+    if (drop == 0) return;
+    logStart = changes[drop - 1].tick + 1;
+    changes.erase(changes.begin(), changes.begin() + drop);
+    if (reported != NOT_REPORTED) {
+        reported = reported >= drop ? reported - drop : NOT_REPORTED;
+    }
+}
@@ -0,0 +1,268 @@
+#include "PlanViews.h"
+
+#include <iomanip>
+
+// No rule of 3 needed - all members are values.
+
+static const char *POLICY_NAMES[] = {"nve", "bal", "eco", "sus"};
+static const char *TYPE_NAMES[] = {"VILLAGE", "CITY", "METROPOLIS"};
+
+// Constructor
+PlanViews::PlanViews() : entries(), ranked(), bySettlement(), byType(), byPolicy(), operationalFacilities(0),
+    facilitiesUnderConstruction(0), plansBySettlement(), plansByType(), plansByPolicy(), plansByStatus() {}
+
+// Start tracking a new plan
+void PlanViews::addPlan(const Plan &plan) {
+    int planId = plan.getPlanId();
+    if (entries.size() <= static_cast<size_t>(planId)) {
+        entries.resize(planId + 1);
+    }
+    PlanEntry &entry = entries[planId];
+    entry.settlementId = plan.getSettlementId();
+    entry.settlementType = static_cast<int>(plan.getSettlement().getType());
+    entry.policy = policyIndex(plan);
+    entry.status = static_cast<int>(plan.getStatus());
+    entry.scores[0] = plan.getlifeQualityScore();
+    entry.scores[1] = plan.getEconomyScore();
+    entry.scores[2] = plan.getEnvironmentScore();
+    entry.operational = 0;
+    entry.underConstruction = 0;
+    countFacilities(entry, plan);
+    if (bySettlement.size() <= entry.settlementId) {
+        bySettlement.resize(entry.settlementId + 1);
+        plansBySettlement.resize(entry.settlementId + 1);
+    }
+    plansBySettlement[entry.settlementId].push_back(planId);
+    plansByType[entry.settlementType].push_back(planId);
+    account(planId, 1);
+}
+
+// Makes room for plans up to the given count, so adding them does not reallocate
+void PlanViews::reserve(size_t plans) {
+    if (plans > entries.capacity()) {
+        entries.reserve(max(plans, 2 * entries.capacity()));
+    }
+}
+
+// Refresh a plan's scores and status after a step (its policy is unchanged); cheap when nothing changed
+void PlanViews::updateState(const Plan &plan) {
+    PlanEntry &entry = entries[plan.getPlanId()];
+    countFacilities(entry, plan);
+    int status = static_cast<int>(plan.getStatus());
+    int scores[NUM_OF_METRICS] = {plan.getlifeQualityScore(), plan.getEconomyScore(), plan.getEnvironmentScore()};
+    if (status == entry.status && scores[0] == entry.scores[0] && scores[1] == entry.scores[1] && scores[2] == entry.scores[2]) {
+        return;
+    }
+    account(plan.getPlanId(), -1);
+    entry.status = status;
+    for (int metric = 0; metric < NUM_OF_METRICS; metric++) {
+        entry.scores[metric] = scores[metric];
+    }
+    account(plan.getPlanId(), 1);
+}
+
+// Refresh a plan after its policy (and possibly its scores) changed
+void PlanViews::updatePolicy(const Plan &plan) {
+    account(plan.getPlanId(), -1);
+    PlanEntry &entry = entries[plan.getPlanId()];
+    countFacilities(entry, plan);
+    entry.policy = policyIndex(plan);
+    entry.status = static_cast<int>(plan.getStatus());
+    entry.scores[0] = plan.getlifeQualityScore();
+    entry.scores[1] = plan.getEconomyScore();
+    entry.scores[2] = plan.getEnvironmentScore();
+    account(plan.getPlanId(), 1);
+}
+
+// Recompute every view from scratch (after a restore)
+void PlanViews::rebuild(const deque<Plan> &plans) {
+    *this = PlanViews();
+    for (const Plan &plan : plans) {
+        addPlan(plan);
+    }
+}
+
+// The k best plans by a metric, as (planId, score), best first
+vector<pair<int, int>> PlanViews::top(ScoreMetric metric, size_t k) const {
+    vector<pair<int, int>> result;
+    const set<pair<int, int>> &ranking = ranked[static_cast<int>(metric)];
+    for (auto it = ranking.rbegin(); it != ranking.rend() && result.size() < k; ++it) {
+        result.emplace_back(-it->second, it->first);
+    }
+    return result;
+}
+
+// Operational facilities of all plans
+size_t PlanViews::getOperationalFacilities() const {
+    return operationalFacilities;
+}
+
+// Facilities under construction in all plans
+size_t PlanViews::getFacilitiesUnderConstruction() const {
+    return facilitiesUnderConstruction;
+}
+
+// The settlement of a tracked plan, without looking the plan up
+size_t PlanViews::getSettlementId(int planId) const {
+    return entries[planId].settlementId;
+}
+
+// A tracked plan's status, policy and scores, as "plans" prints them
+const string PlanViews::planToString(int planId) const {
+    const PlanEntry &entry = entries[planId];
+    ostringstream oss;
+    oss << "PlanStatus: " << (entry.status == static_cast<int>(PlanStatus::AVALIABLE) ? "AVAILABLE" : "BUSY")
+        << " SelectionPolicy: " << POLICY_NAMES[entry.policy]
+        << " LifeQualityScore: " << entry.scores[0]
+        << " EconomyScore: " << entry.scores[1]
+        << " EnvironmentScore: " << entry.scores[2];
+    return oss.str();
+}
+
+// Totals per settlement type and averages per policy
+const string PlanViews::toString() const {
+    ostringstream oss;
+    for (int type = 0; type < NUM_OF_TYPES; type++) {
+        oss << "SettlementType: " << TYPE_NAMES[type] << " " << totalsToString(byType[type]) << "\n";
+    }
+    oss << fixed << setprecision(2);
+    for (int policy = 0; policy < NUM_OF_POLICIES; policy++) {
+        const Totals &totals = byPolicy[policy];
+        double plans = totals.plans == 0 ? 1 : totals.plans;
+        oss << "Policy: " << POLICY_NAMES[policy] << " Plans: " << totals.plans
+            << " AvgLifeQuality_Score: " << totals.scores[0] / plans
+            << " AvgEconomy_Score: " << totals.scores[1] / plans
+            << " AvgEnvironment_Score: " << totals.scores[2] / plans << "\n";
+    }
+    return oss.str();
+}
+
+// Totals of one settlement
+const string PlanViews::settlementToString(size_t settlementId) const {
+    return settlementId < bySettlement.size() ? totalsToString(bySettlement[settlementId]) : totalsToString(Totals());
+}
+
+// Calls visit with the id of every plan matching the query, in id order, and returns
+// how many matched. Candidates come from the smallest index the query can use.
+size_t PlanViews::query(const PlanQuery &query, const function<void(int)> &visit) const {
+    const vector<int> *list = nullptr;
+    const set<int> *ids = nullptr;
+    size_t candidates = entries.size();
+    if (query.settlementId >= 0) {
+        static const vector<int> NONE;
+        list = static_cast<size_t>(query.settlementId) < plansBySettlement.size() ? &plansBySettlement[query.settlementId] : &NONE;
+        candidates = list->size();
+    }
+    if (query.settlementType >= 0 && plansByType[query.settlementType].size() < candidates) {
+        list = &plansByType[query.settlementType];
+        candidates = list->size();
+    }
+    if (query.policy >= 0 && plansByPolicy[query.policy].size() < candidates) {
+        list = nullptr;
+        ids = &plansByPolicy[query.policy];
+        candidates = ids->size();
+    }
+    if (query.status >= 0 && plansByStatus[query.status].size() < candidates) {
+        list = nullptr;
+        ids = &plansByStatus[query.status];
+        candidates = ids->size();
+    }
+
+    size_t count = 0;
+    auto check = [&](int planId) {
+        if (matches(planId, query)) {
+            visit(planId);
+            count++;
+        }
+    };
+    if (ids != nullptr) {
+        for (int planId : *ids) check(planId);
+    } else if (list != nullptr) {
+        for (int planId : *list) check(planId);
+    } else {
+        for (size_t planId = 0; planId < entries.size(); planId++) check(planId);
+    }
+    return count;
+}
+
+// Parse a metric name given on the command line
+bool PlanViews::parseMetric(const string &name, ScoreMetric &metric) {
+    if (name == "lifeQuality") metric = ScoreMetric::LIFE_QUALITY;
+    else if (name == "economy") metric = ScoreMetric::ECONOMY;
+    else if (name == "environment") metric = ScoreMetric::ENVIRONMENT;
+    else return false;
+    return true;
+}
+
+// Index of a policy name in POLICY_NAMES, or -1
+int PlanViews::parsePolicy(const string &name) {
+    for (int policy = 0; policy < NUM_OF_POLICIES; policy++) {
+        if (name == POLICY_NAMES[policy]) return policy;
+    }
+    return -1;
+}
+
+// Index of the plan's policy in POLICY_NAMES
+int PlanViews::policyIndex(const Plan &plan) {
+    int policy = parsePolicy(plan.getSelectionPolicy()->toString());
+    return policy < 0 ? 0 : policy;
+}
+
+// Add (sign 1) or remove (sign -1) a plan's entry from every view
+void PlanViews::account(int planId, int sign) {
+    const PlanEntry &entry = entries[planId];
+    Totals *totals[] = {&bySettlement[entry.settlementId], &byType[entry.settlementType], &byPolicy[entry.policy]};
+    for (Totals *target : totals) {
+        target->plans += sign;
+        for (int metric = 0; metric < NUM_OF_METRICS; metric++) {
+            target->scores[metric] += sign * entry.scores[metric];
+        }
+    }
+    for (int metric = 0; metric < NUM_OF_METRICS; metric++) {
+        if (sign > 0) {
+            ranked[metric].emplace(entry.scores[metric], -planId);
+        } else {
+            ranked[metric].erase(make_pair(entry.scores[metric], -planId));
+        }
+    }
+    if (sign > 0) {
+        plansByPolicy[entry.policy].insert(planId);
+        plansByStatus[entry.status].insert(planId);
+    } else {
+        plansByPolicy[entry.policy].erase(planId);
+        plansByStatus[entry.status].erase(planId);
+    }
+}
+
+// Move a plan's facility counts in the totals to its current ones
+void PlanViews::countFacilities(PlanEntry &entry, const Plan &plan) {
+    size_t operational = plan.getFacilities().size();
+    size_t underConstruction = plan.getFacilitiesUnderConstruction().size();
+    operationalFacilities += operational - entry.operational;
+    facilitiesUnderConstruction += underConstruction - entry.underConstruction;
+    entry.operational = operational;
+    entry.underConstruction = underConstruction;
+}
+
+// Check a plan's entry against every condition of the query
+bool PlanViews::matches(int planId, const PlanQuery &query) const {
+    const PlanEntry &entry = entries[planId];
+    if (query.settlementId >= 0 && entry.settlementId != static_cast<size_t>(query.settlementId)) return false;
+    if (query.settlementType >= 0 && entry.settlementType != query.settlementType) return false;
+    if (query.policy >= 0 && entry.policy != query.policy) return false;
+    if (query.status >= 0 && entry.status != query.status) return false;
+    for (int metric = 0; metric < NUM_OF_METRICS; metric++) {
+        if (entry.scores[metric] < query.minScores[metric] || entry.scores[metric] > query.maxScores[metric]) return false;
+    }
+    return true;
+}
+
+// Format plan count and score totals
+const string PlanViews::totalsToString(const Totals &totals) const {
+    ostringstream oss;
+    oss << "Plans: " << totals.plans
+        << " LifeQuality_Score: " << totals.scores[0]
+        << " Economy_Score: " << totals.scores[1]
+        << " Environment_Score: " << totals.scores[2];
+    return oss.str();
+}
@@ -0,0 +1,160 @@
+#include "ScheduleSearch.h"
+
+#include <chrono>
+#include <unordered_map>
+
+// Rule of 3: copying is deleted, the destructor frees the best plan copy.
+
+// Constructor
+ScheduleSearch::ScheduleSearch(const Plan &plan, const int numOfSteps, const int windowSize,
+                               const int lifeQualityWeight, const int economyWeight, const int environmentWeight)
+    : origin(plan), numOfSteps(numOfSteps), windowSize(windowSize), lifeQualityWeight(lifeQualityWeight),
+      economyWeight(economyWeight), environmentWeight(environmentWeight), best(), statesExplored(0),
+      statesMerged(0), finished(true) {}
+
+// Destructor
+ScheduleSearch::~ScheduleSearch() {
+    delete best.plan;
+}
+
+// Runs the beam search, stopping at a window boundary once the budget is spent
+void ScheduleSearch::run(const int budgetMs, ThreadPool &pool) {
+    static const vector<string> POLICIES = {"nve", "bal", "eco", "sus"};
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budgetMs);
+    const int numOfWindows = (numOfSteps + windowSize - 1) / windowSize;
+
+    vector<State> beam(1);
+    beam[0].plan = new Plan(origin);
+    beam[0].weightedScore = weigh(*beam[0].plan);
+
+    int window = 0;
+    for (; window < numOfWindows && std::chrono::steady_clock::now() < deadline; window++) {
+        const int steps = min(windowSize, numOfSteps - window * windowSize);
+
+        // Expand every state with every policy, in parallel
+        vector<State> candidates(beam.size() * POLICIES.size());
+        for (size_t i = 0; i < beam.size(); i++) {
+            for (size_t j = 0; j < POLICIES.size(); j++) {
+                const State &parent = beam[i];
+                State &candidate = candidates[i * POLICIES.size() + j];
+                const string &policyName = POLICIES[j];
+                pool.submit([this, &parent, &candidate, &policyName, steps] {
+                    Plan *fork = new Plan(*parent.plan);
+                    if (fork->getSelectionPolicy()->toString() != policyName) {
+                        fork->setSelectionPolicy(fork->createPolicy(policyName));
+                    }
+                    try {
+                        for (int k = 0; k < steps; k++) {
+                            fork->step();
+                        }
+                    } catch (const exception &e) {
+                        // The policy found nothing to build: drop this branch
+                        delete fork;
+                        return;
+                    }
+                    candidate.plan = fork;
+                    candidate.schedule = parent.schedule;
+                    candidate.schedule.push_back(policyName);
+                    candidate.weightedScore = weigh(*fork);
+                });
+            }
+        }
+        pool.wait();
+        statesExplored += candidates.size();
+
+        for (State &state : beam) {
+            delete state.plan;
+        }
+        beam.clear();
+
+        // Keep the best distinct states; equal states lead to identical futures. The hash only
+        // finds the states that may be equal, and a full comparison confirms it.
+        stable_sort(candidates.begin(), candidates.end(), [](const State &a, const State &b) {
+            if ((a.plan == nullptr) != (b.plan == nullptr)) return a.plan != nullptr;
+            return a.weightedScore > b.weightedScore;
+        });
+        unordered_map<size_t, vector<const Plan*>> seen;
+        for (State &candidate : candidates) {
+            if (candidate.plan == nullptr) continue;
+            bool merged = false;
+            if (beam.size() < BEAM_WIDTH) {
+                vector<const Plan*> &sameHash = seen[candidate.plan->hashState()];
+                for (const Plan *kept : sameHash) {
+                    if (kept->isSameState(*candidate.plan)) {
+                        merged = true;
+                        break;
+                    }
+                }
+                if (!merged) sameHash.push_back(candidate.plan);
+            }
+            if (beam.size() == BEAM_WIDTH || merged) {
+                if (merged) statesMerged++;
+                delete candidate.plan;
+                continue;
+            }
+            beam.push_back(candidate);
+        }
+        if (beam.empty()) break;
+    }
+
+    if (beam.empty()) {
+        // Every branch failed: step the origin with its own policy from the start
+        beam.resize(1);
+        beam[0].plan = new Plan(origin);
+        window = 0;
+    }
+
+    // Out of time: finish the best state with its current policy
+    best = beam[0];
+    for (size_t i = 1; i < beam.size(); i++) {
+        delete beam[i].plan;
+    }
+    if (window < numOfWindows) {
+        finished = false;
+        string current = best.plan->getSelectionPolicy()->toString();
+        for (int step = window * windowSize; step < numOfSteps; step++) {
+            best.plan->step();
+        }
+        for (; window < numOfWindows; window++) {
+            best.schedule.push_back(current);
+        }
+        best.weightedScore = weigh(*best.plan);
+    }
+}
+
+// Chosen policy per window
+const vector<string> &ScheduleSearch::getSchedule() const {
+    return best.schedule;
+}
+
+// The plan copy at the end of the best schedule
+const Plan &ScheduleSearch::getResult() const {
+    return *best.plan;
+}
+
+long ScheduleSearch::getWeightedScore() const {
+    return best.weightedScore;
+}
+
+int ScheduleSearch::getWindowSize() const {
+    return windowSize;
+}
+
+size_t ScheduleSearch::getStatesExplored() const {
+    return statesExplored;
+}
+
+size_t ScheduleSearch::getStatesMerged() const {
+    return statesMerged;
+}
+
+bool ScheduleSearch::isFinished() const {
+    return finished;
+}
+
+// Objective: weighted sum of the three scores
+long ScheduleSearch::weigh(const Plan &plan) const {
+    return static_cast<long>(lifeQualityWeight) * plan.getlifeQualityScore() +
+           static_cast<long>(economyWeight) * plan.getEconomyScore() +
+           static_cast<long>(environmentWeight) * plan.getEnvironmentScore();
+}
@@ -10,7 +10,7 @@
 NaiveSelection::NaiveSelection() : lastSelectedIndex(-1) {}
 
 // Selects the next facility one by one
-const FacilityType& NaiveSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+const FacilityType& NaiveSelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
     if (facilitiesOptions.empty()) {
         throw runtime_error("No facilities available to select");
     }
@@ -29,6 +29,22 @@ NaiveSelection* NaiveSelection::clone() const {
     return new NaiveSelection(*this);
 }
 
+// Hash of the policy's kind and selection cursor
+size_t NaiveSelection::hashState() const {
+    return hash<string>()("nve") ^ hash<int>()(lastSelectedIndex);
+}
+
+// Whether the other policy is in the same state, so it selects the same facilities from now on
+bool NaiveSelection::isSameState(const SelectionPolicy &other) const {
+    const NaiveSelection *same = dynamic_cast<const NaiveSelection*>(&other);
+    return same != nullptr && same->lastSelectedIndex == lastSelectedIndex;
+}
+
+// Counter of this policy's selections
+Stats::Counter NaiveSelection::getSelectionCounter() const {
+    return Stats::SELECTIONS_NAIVE;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ********************************************** BalancedSelection *************************************************** //
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,7 +54,7 @@ BalancedSelection::BalancedSelection(int lifeQualityScore, int economyScore, int
     : LifeQualityScore(lifeQualityScore), EconomyScore(economyScore), EnvironmentScore(environmentScore) {}
 
 // Selects the facility with the most balanced scores (smallest range between scores)
-const FacilityType& BalancedSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+const FacilityType& BalancedSelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
     const FacilityType* bestFacility = nullptr;
     int smallestRange = INT_MAX; 
 
@@ -76,6 +92,27 @@ BalancedSelection* BalancedSelection::clone() const {
     return new BalancedSelection(*this);
 }
 
+// Hash of the policy's kind and accumulated scores
+size_t BalancedSelection::hashState() const {
+    size_t seed = hash<string>()("bal");
+    for (int score : {LifeQualityScore, EconomyScore, EnvironmentScore}) {
+        seed = seed * 31 + hash<int>()(score);
+    }
+    return seed;
+}
+
+// Whether the other policy is in the same state, so it selects the same facilities from now on
+bool BalancedSelection::isSameState(const SelectionPolicy &other) const {
+    const BalancedSelection *same = dynamic_cast<const BalancedSelection*>(&other);
+    return same != nullptr && same->LifeQualityScore == LifeQualityScore && same->EconomyScore == EconomyScore &&
+           same->EnvironmentScore == EnvironmentScore;
+}
+
+// Counter of this policy's selections
+Stats::Counter BalancedSelection::getSelectionCounter() const {
+    return Stats::SELECTIONS_BALANCED;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ********************************************** EconomySelection **************************************************** //
@@ -85,7 +122,7 @@ BalancedSelection* BalancedSelection::clone() const {
 EconomySelection::EconomySelection() : lastSelectedIndex(-1) {}
 
 // Selects the next facility with an ECONOMY category
-const FacilityType& EconomySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+const FacilityType& EconomySelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
     for (size_t i = 1; i <= facilitiesOptions.size(); i++) {
         size_t curr = (lastSelectedIndex + i) % facilitiesOptions.size(); 
         if (FacilityCategory::ECONOMY == facilitiesOptions[curr].getCategory()) {
@@ -106,6 +143,22 @@ EconomySelection* EconomySelection::clone() const {
     return new EconomySelection(*this);
 }
 
+// Hash of the policy's kind and selection cursor
+size_t EconomySelection::hashState() const {
+    return hash<string>()("eco") ^ hash<int>()(lastSelectedIndex);
+}
+
+// Whether the other policy is in the same state, so it selects the same facilities from now on
+bool EconomySelection::isSameState(const SelectionPolicy &other) const {
+    const EconomySelection *same = dynamic_cast<const EconomySelection*>(&other);
+    return same != nullptr && same->lastSelectedIndex == lastSelectedIndex;
+}
+
+// Counter of this policy's selections
+Stats::Counter EconomySelection::getSelectionCounter() const {
+    return Stats::SELECTIONS_ECONOMY;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // ******************************************* SustainabilitySelection ************************************************ //
@@ -115,7 +168,7 @@ EconomySelection* EconomySelection::clone() const {
 SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(-1) {}
 
 // Selects the next facility with an ENVIRONMENT category
-const FacilityType& SustainabilitySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
+const FacilityType& SustainabilitySelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
     for (size_t i = 1; i <= facilitiesOptions.size(); i++) {
         size_t curr = (lastSelectedIndex + i) % facilitiesOptions.size(); 
         if (FacilityCategory::ENVIRONMENT == facilitiesOptions[curr].getCategory()) {
@@ -134,4 +187,20 @@ const string SustainabilitySelection::toString() const {
 // Clone
 SustainabilitySelection* SustainabilitySelection::clone() const {
     return new SustainabilitySelection(*this);
-}
\ No newline at end of file
+}
+
+// Hash of the policy's kind and selection cursor
+size_t SustainabilitySelection::hashState() const {
+    return hash<string>()("sus") ^ hash<int>()(lastSelectedIndex);
+}
+
+// Whether the other policy is in the same state, so it selects the same facilities from now on
+bool SustainabilitySelection::isSameState(const SelectionPolicy &other) const {
+    const SustainabilitySelection *same = dynamic_cast<const SustainabilitySelection*>(&other);
+    return same != nullptr && same->lastSelectedIndex == lastSelectedIndex;
+}
+
+// Counter of this policy's selections
+Stats::Counter SustainabilitySelection::getSelectionCounter() const {
+    return Stats::SELECTIONS_SUSTAINABILITY;
+}
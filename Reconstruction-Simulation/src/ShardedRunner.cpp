@@ -0,0 +1,288 @@
+#include "ShardedRunner.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Rule of 3: copying is deleted, the destructor stops the workers and unmaps the region.
+
+namespace {
+
+const size_t PAGE_SIZE = 4096;
+
+// Commands that only touch one plan, named by their first argument
+const vector<string> PLAN_COMMANDS = {"planStatus", "changePolicy", "fork", "forkStep", "forkPolicy", "forkStatus",
+                                      "commit", "discard", "schedule"};
+
+bool writeAll(int fd, const char *data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) return false;
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool readAll(int fd, char *data, size_t size) {
+    while (size > 0) {
+        ssize_t received = read(fd, data, size);
+        if (received <= 0) return false;
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+// A length-prefixed string
+bool sendMessage(int fd, const string &message) {
+    uint32_t size = message.size();
+    return writeAll(fd, reinterpret_cast<const char*>(&size), sizeof(size)) && writeAll(fd, message.data(), size);
+}
+
+bool receiveMessage(int fd, string &message) {
+    uint32_t size;
+    if (!readAll(fd, reinterpret_cast<char*>(&size), sizeof(size))) return false;
+    message.resize(size);
+    return size == 0 || readAll(fd, &message[0], size);
+}
+
+} // namespace
+
+// Constructor: maps the shared region; workers start with run()
+ShardedRunner::ShardedRunner(Simulation &simulation, int shardCount)
+    : simulation(simulation), shardCount(shardCount), everyShard(), partitionSize(0), region(nullptr), workers(),
+      settlementNames(), actionsLog(), backups() {
+    if (shardCount < 1) throw runtime_error("Invalid shard count");
+    for (int shard = 0; shard < shardCount; shard++) {
+        everyShard.push_back(shard);
+    }
+    size_t size = sizeof(Partition) + (MAX_PLANS_PER_SHARD - 1) * sizeof(PlanSlot);
+    partitionSize = (size + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    // Pages are only backed once a worker writes to them
+    void *mapped = mmap(nullptr, partitionSize * shardCount, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapped == MAP_FAILED) throw runtime_error("Unable to map shared plan partitions");
+    region = static_cast<char*>(mapped);
+
+    // Plan id -> settlement name, for the close report
+    for (const Plan &plan : simulation.getPlans()) {
+        if (settlementNames.size() <= static_cast<size_t>(plan.getPlanId())) {
+            settlementNames.resize(plan.getPlanId() + 1);
+        }
+        settlementNames[plan.getPlanId()] = plan.getSettlement().getName();
+    }
+}
+
+// Destructor
+ShardedRunner::~ShardedRunner() {
+    stopWorkers();
+    munmap(region, partitionSize * shardCount);
+}
+
+// Coordinator loop: routes stdin's commands until close or the end of the input
+void ShardedRunner::run() {
+    simulation.open();
+    startWorkers();
+    string line;
+    while (getline(cin, line) && dispatch(line)) {}
+    stopWorkers();
+}
+
+// Forks one worker per shard from the loaded simulation
+void ShardedRunner::startWorkers() {
+    cout.flush(); // Or the workers would print it again
+    for (int shard = 0; shard < shardCount; shard++) {
+        int commands[2], replies[2];
+        if (pipe(commands) < 0 || pipe(replies) < 0) throw runtime_error("Unable to create shard pipes");
+        pid_t pid = fork();
+        if (pid < 0) throw runtime_error("Unable to start shard");
+        if (pid == 0) {
+            // Only this worker's ends stay open, so every worker sees its own end of input
+            for (const Worker &worker : workers) {
+                ::close(worker.commands);
+                ::close(worker.replies);
+            }
+            ::close(commands[1]);
+            ::close(replies[0]);
+            serve(shard, commands[0], replies[1]);
+            _exit(0);
+        }
+        ::close(commands[0]);
+        ::close(replies[1]);
+        workers.push_back(Worker{pid, commands[1], replies[0]});
+    }
+}
+
+// Worker loop: executes one command line at a time and replies with what it logged and printed
+void ShardedRunner::serve(int shard, int commands, int replies) {
+    simulation.keepShard(shard, shardCount);
+    publish(shard);
+    string pending;
+    char buffer[4096];
+    while (true) {
+        size_t lineEnd;
+        while ((lineEnd = pending.find('\n')) == string::npos) {
+            ssize_t received = read(commands, buffer, sizeof(buffer));
+            if (received <= 0) return;
+            pending.append(buffer, received);
+        }
+        string line = pending.substr(0, lineEnd);
+        pending.erase(0, lineEnd + 1);
+
+        ostringstream output;
+        streambuf *console = cout.rdbuf(output.rdbuf());
+        const BaseAction *action = simulation.executeLine(line);
+        cout.rdbuf(console);
+        publish(shard);
+        if (!sendMessage(replies, action != nullptr ? action->toString() : "") || !sendMessage(replies, output.str())) {
+            return;
+        }
+    }
+}
+
+// Writes this worker's plans to its partition
+void ShardedRunner::publish(int shard) const {
+    const deque<Plan> &plans = simulation.getPlans();
+    if (plans.size() > MAX_PLANS_PER_SHARD) throw runtime_error("Too many plans for one shard");
+    Partition &owned = partition(shard);
+    size_t count = 0;
+    for (const Plan &plan : plans) {
+        owned.slots[count++] = PlanSlot{plan.getPlanId(), static_cast<int>(plan.getStatus()), plan.getlifeQualityScore(),
+                                        plan.getEconomyScore(), plan.getEnvironmentScore(),
+                                        static_cast<int>(plan.getFacilitiesUnderConstruction().size())};
+    }
+    owned.count = count;
+}
+
+ShardedRunner::Partition &ShardedRunner::partition(int shard) const {
+    return *reinterpret_cast<Partition*>(region + shard * partitionSize);
+}
+
+// Routes one command; returns false once the simulation is closed
+bool ShardedRunner::dispatch(const string &line) {
+    vector<string> args = Auxiliary::parseArguments(line);
+    if (args.empty()) return true;
+    try {
+        delete Simulation::parseAction(args); // Rejects what a single process would reject, with the same message
+    } catch (const exception &e) {
+        Stats::add(Stats::PARSE_ERRORS);
+        cout << "Error: " << e.what() << endl;
+        return true;
+    }
+
+    const string &command = args[0];
+    string logged;
+    if (command == "close") {
+        close();
+        return false;
+    } else if (command == "log") {
+        for (const string &entry : actionsLog) {
+            cout << entry << "\n";
+        }
+        cout << flush;
+        logged = "log COMPLETED";
+    } else if (command == "settlement" || command == "facility" || (command == "step" && args.size() == 2)) {
+        logged = send(everyShard, line, 0);
+    } else if (command == "plan") {
+        // Every worker numbers the plan; only its owner creates it
+        logged = send(everyShard, line, settlementNames.size() % shardCount);
+        if (isCompleted(logged)) {
+            settlementNames.push_back(args[1]);
+        }
+    } else if (command == "backup") {
+        // Every worker saves its own plans; the coordinator saves what it knows about all of them
+        logged = send(everyShard, line, 0);
+        string name = args.size() == 2 ? args[1] : "";
+        backups.erase(name);
+        backups.emplace(name, Backup{actionsLog, settlementNames});
+    } else if (command == "restore" && args.size() <= 2) {
+        logged = send(everyShard, line, 0);
+        if (isCompleted(logged)) {
+            const Backup &backup = backups.at(args.size() == 2 ? args[1] : "");
+            actionsLog = backup.actionsLog;
+            settlementNames = backup.settlementNames;
+        }
+    } else if (find(PLAN_COMMANDS.begin(), PLAN_COMMANDS.end(), command) != PLAN_COMMANDS.end()) {
+        int planId = stoi(args[1]);
+        int owner = (planId % shardCount + shardCount) % shardCount;
+        logged = send(vector<int>{owner}, line, owner);
+    } else {
+        cout << "Error: " << line << " is not available with shards" << endl;
+    }
+    if (!logged.empty()) {
+        actionsLog.push_back(logged);
+    }
+    return true;
+}
+
+// Sends a line to the given workers and waits for all of them. Prints one worker's
+// output and returns what it logged (empty if nothing).
+const string ShardedRunner::send(const vector<int> &shards, const string &line, int replyFrom) {
+    for (int shard : shards) {
+        if (!writeAll(workers[shard].commands, line.data(), line.size()) || !writeAll(workers[shard].commands, "\n", 1)) {
+            throw runtime_error("Shard " + to_string(shard) + " stopped");
+        }
+    }
+    string reply;
+    for (int shard : shards) {
+        string logged, output;
+        if (!receiveMessage(workers[shard].replies, logged) || !receiveMessage(workers[shard].replies, output)) {
+            throw runtime_error("Shard " + to_string(shard) + " stopped");
+        }
+        if (shard != replyFrom) continue;
+        cout << output << flush;
+        reply = logged;
+    }
+    return reply;
+}
+
+// Whether a logged action succeeded
+bool ShardedRunner::isCompleted(const string &logged) {
+    const string suffix = " COMPLETED";
+    return logged.size() >= suffix.size() && logged.compare(logged.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Closes every worker and prints every plan's results in id order, from the shared partitions
+void ShardedRunner::close() {
+    ostringstream discarded;
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+    send(everyShard, "close", 0);
+    cout.rdbuf(console);
+
+    vector<const PlanSlot*> slots;
+    for (int shard = 0; shard < shardCount; shard++) {
+        const Partition &owned = partition(shard);
+        for (size_t i = 0; i < owned.count; i++) {
+            slots.push_back(&owned.slots[i]);
+        }
+    }
+    sort(slots.begin(), slots.end(), [](const PlanSlot *a, const PlanSlot *b) { return a->planId < b->planId; });
+    for (const PlanSlot *slot : slots) {
+        cout << "PlanID: " << slot->planId << "\n";
+        cout << "SettlementName: " << settlementNames[slot->planId] << "\n";
+        cout << "LifeQuality_Score: " << slot->lifeQualityScore << "\n";
+        cout << "Economy_Score: " << slot->economyScore << "\n";
+        cout << "Environment_Score: " << slot->environmentScore << "\n";
+        cout << "----------------------------------------" << endl;
+    }
+    cout << "Simulation closed successfully." << endl;
+}
+
+// Ends every worker's input and waits for it to exit
+void ShardedRunner::stopWorkers() {
+    for (const Worker &worker : workers) {
+        ::close(worker.commands);
+    }
+    for (const Worker &worker : workers) {
+        waitpid(worker.pid, nullptr, 0);
+        ::close(worker.replies);
+    }
+    workers.clear();
+}
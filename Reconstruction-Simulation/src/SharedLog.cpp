@@ -0,0 +1,43 @@
+#include "SharedLog.h"
+
+#include <new>
+#include <stdexcept>
+
+// Rule of 3 used in Storage: copying is deleted, the destructor destroys the lines and frees the chunks.
+// SharedLog itself is a shared pointer and a count, so the defaults are enough.
+
+// Constructor
+SharedLog::Storage::Storage() : chunks(), count(0) {}
+
+// Destructor
+SharedLog::Storage::~Storage() {
+    for (size_t i = 0; i < count; i++) {
+        size_t chunk = chunkOf(i);
+        chunks[chunk][i - chunkStart(chunk)].~string();
+    }
+    for (string *chunk : chunks) {
+        ::operator delete(chunk);
+    }
+}
+
+// Constructor: the empty log
+SharedLog::SharedLog() : storage(), count(0) {}
+
+// Move to the version with one more line at the end. Only the newest version of a
+// store may grow; readers of it and of older versions never look past their count.
+void SharedLog::append(const string &line) {
+    if (!storage) {
+        storage = std::make_shared<Storage>();
+    }
+    if (storage->count != count) {
+        throw std::logic_error("Only the newest version of a log can grow");
+    }
+    size_t chunk = chunkOf(count);
+    if (chunk >= MAX_CHUNKS) throw std::length_error("Too many log lines");
+    if (storage->chunks[chunk] == nullptr) {
+        storage->chunks[chunk] = static_cast<string*>(::operator new((FIRST_CHUNK << chunk) * sizeof(string)));
+    }
+    new (&storage->chunks[chunk][count - chunkStart(chunk)]) string(line);
+    storage->count++;
+    count++;
+}
@@ -1,11 +1,20 @@
 #include "Simulation.h"
 #include "Action.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "MetricsServer.h"
+#include "Memory.h"
+#include "StateView.h"
+#include "StepRunner.h"
+#include "Telemetry.h"
 
 // Rule of 5 used here - Class contains resources.
 
 // Constructor: Initialize the simulation using a configuration file
-Simulation::Simulation(const string &configFilePath) : isRunning(false), planCounter(0),actionsLog(), plans(), settlements(),
-    facilitiesOptions() {
+Simulation::Simulation(const string &configFilePath) : isRunning(false), publishing(false), runner(new StepRunner(*this)), telemetry(nullptr), shard(0), shardCount(1), planCounter(0), tick(0), generation(0), actionsLog(), plans(), settlements(),
+    settlementIds(), catalog(), visibleCatalog(), forks(), views() {
+    TraceSpan span("loadConfig", "setup");
+    vector<FacilityType> facilitiesOptions; // Becomes the catalog once every line is read
 
     // Open the configuration file for reading
     ifstream configFile(configFilePath);
@@ -25,6 +34,7 @@ Simulation::Simulation(const string &configFilePath) : isRunning(false), planCou
 
         // Handle "settlement" configuration
         if (args[0] == "settlement") {
+            MemoryScope scope(MemoryTag::SETTLEMENTS);
             if (args.size() != 3) throw runtime_error("Invalid settlement configuration");
             if(!isSettlementExists(args[1])){
                 SettlementType type = static_cast<SettlementType>(stoi(args[2]));
@@ -32,17 +42,25 @@ Simulation::Simulation(const string &configFilePath) : isRunning(false), planCou
             }
         // Handle "facility" configuration
         } else if (args[0] == "facility") {
+            MemoryScope scope(MemoryTag::FACILITY_TYPES);
             if (args.size() != 7) throw runtime_error("Invalid facility configuration");
-            if (!isFacilityExists(args[1])){
+            bool exists = false;
+            for (const FacilityType &type : facilitiesOptions) {
+                if (type.getName() == args[1]) {
+                    exists = true;
+                    break;
+                }
+            }
+            if (!exists){
                 FacilityCategory category = static_cast<FacilityCategory>(stoi(args[2]));
-                FacilityType facility(args[1], category, stoi(args[3]), stoi(args[4]), stoi(args[5]), stoi(args[6]));
-                addFacility(facility);
+                facilitiesOptions.push_back(FacilityType(args[1], category, stoi(args[3]), stoi(args[4]), stoi(args[5]), stoi(args[6])));
             }
         // Handle "plan" configuration
         } else if (args[0] == "plan") {
+            MemoryScope scope(MemoryTag::PLANS);
             if (args.size() != 3) throw runtime_error("Invalid plan configuration");
             if (!isSettlementExists(args[1])) throw runtime_error("Settlement not found for plan");
-            const Settlement &settlement = getSettlement(args[1]);
+            const size_t settlementId = getSettlementId(args[1]);
             SelectionPolicy *policy = nullptr;
 
             // Determine the selection policy
@@ -52,45 +70,49 @@ Simulation::Simulation(const string &configFilePath) : isRunning(false), planCou
             else if (args[2] == "env") policy = new SustainabilitySelection();
             else throw runtime_error("Unknown selection policy");
 
-            addPlan(settlement, policy);
+            addPlan(settlementId, policy);
         }
     }
 
     configFile.close();
+    // Shared with any other simulation loaded with the same facilities
+    catalog = FacilityCatalog::intern(facilitiesOptions);
+    visibleCatalog = catalog;
+    bindPlans();
 }
 
 // Copy Constructor
 Simulation::Simulation(const Simulation &other)
     : isRunning(other.isRunning),
+      publishing(false), // Copies are never what readers see
+      runner(nullptr),
+      telemetry(nullptr),
+      shard(other.shard),
+      shardCount(other.shardCount),
       planCounter(other.planCounter),
+      tick(other.tick),
+      generation(0),
       actionsLog(),
       plans(),
       settlements(),
-      facilitiesOptions(other.facilitiesOptions) {
-
-    // Copy settlements
+      settlementIds(other.settlementIds),
+      catalog(other.catalog),
+      visibleCatalog(other.visibleCatalog),
+      forks(),
+      views(other.views) {
+
+    // Copy settlements (same order, so settlement ids stay valid)
+    settlements.reserve(other.settlements.size());
     for (const auto *settlement : other.settlements) {
         settlements.push_back(new Settlement(*settlement)); 
     }
 
-    // Copy plans and match them with the new settlements
+    // Copy plans and bind them to the new tables
     for (const auto &plan : other.plans) {
-        const Settlement &oldSettlement = plan.getSettlement();
-        Settlement *newSettlement = nullptr;
-        
-        // Find the corresponding settlement in the new list
-        for (auto *settlement : settlements) {
-            if (settlement->getName() == oldSettlement.getName()) {
-                newSettlement = settlement; // Found the corresponding settlement
-                break;
-            }
-        }
-
-        // Create a copy of the plan
-        plans.emplace_back(plan.getPlanId(), 
-                           *newSettlement, 
-                           plan.getSelectionPolicy()->clone(), 
-                           facilitiesOptions);
+        plans.emplace_back(plan, settlements, visibleCatalog);
+    }
+    for (const auto &fork : other.forks) {
+        forks[fork.first] = new Plan(*fork.second, settlements, visibleCatalog);
     }
 
     // Copy the action log
@@ -104,36 +126,34 @@ Simulation &Simulation::operator=(const Simulation &other) {
     if (this == &other) return *this; // Handle self-assignment
 
     // Clean up current state
-    for (auto *settlement : settlements) {
-        delete settlement;
-        settlement = nullptr;
-    }
-    settlements.clear();
-
-    for (auto *action : actionsLog) {
-        delete action;
-    }
-    actionsLog.clear();
-
-    plans.clear();
-    facilitiesOptions.clear();
+    clear();
 
     // Copy other fields
     isRunning = other.isRunning;
+    shard = other.shard;
+    shardCount = other.shardCount;
     planCounter = other.planCounter;
+    tick = other.tick;
 
     // Deep copy of settlements
+    settlements.reserve(other.settlements.size());
     for (Settlement* settlement : other.settlements) {
         settlements.push_back(new Settlement(settlement->getName(), settlement->getType()));
     }
+    settlementIds = other.settlementIds;
 
-    // Deep copy of facilitiesOptions
-    facilitiesOptions = vector<FacilityType>(other.facilitiesOptions);
+    // Catalog versions never change, so they are shared rather than copied
+    catalog = other.catalog;
+    visibleCatalog = other.visibleCatalog;
     
-     // Deep copy plans
+     // Deep copy plans, bound to this simulation's tables
     for (const auto& plan : other.plans) {
-        plans.emplace_back(plan); // Calls Plan's copy constructor
+        plans.emplace_back(plan, settlements, visibleCatalog);
     }
+    for (const auto &fork : other.forks) {
+        forks[fork.first] = new Plan(*fork.second, settlements, visibleCatalog);
+    }
+    views = other.views;
 
     // Deep copy of actionsLog
     for (const auto *action : other.actionsLog) {
@@ -146,14 +166,31 @@ Simulation &Simulation::operator=(const Simulation &other) {
 // Move Constructor
 Simulation::Simulation(Simulation &&other) noexcept
     : isRunning(other.isRunning),
+      publishing(other.publishing),
+      runner(nullptr), // A runner steps the simulation it was created for
+      telemetry(other.telemetry),
+      shard(other.shard),
+      shardCount(other.shardCount),
       planCounter(other.planCounter),
+      tick(other.tick),
+      generation(other.generation),
       actionsLog(move(other.actionsLog)),
       plans(move(other.plans)),
       settlements(move(other.settlements)),
-      facilitiesOptions(move(other.facilitiesOptions)) {
+      settlementIds(move(other.settlementIds)),
+      catalog(other.catalog), // The moved-from simulation keeps a valid catalog too
+      visibleCatalog(other.visibleCatalog),
+      forks(move(other.forks)),
+      views(move(other.views)) {
+    // Plans still point at the moved-from tables
+    bindPlans();
+
     // Clear the state of the moved-from object
     other.isRunning = false;
+    other.publishing = false;
+    other.telemetry = nullptr;
     other.planCounter = 0;
+    other.tick = 0;
 }
 
 // Move Assignment Operator
@@ -161,54 +198,89 @@ Simulation &Simulation::operator=(Simulation &&other) noexcept {
     if (this == &other) return *this; // Handle self-assignment
 
     // Clean up current state
-    for (auto *settlement : this->settlements) {
-        delete settlement;
-    }
-    this->settlements.clear();
-
-    for (auto *action : actionsLog) {
-        delete action;
-    }
-    actionsLog.clear();
-
-    plans.clear();
-    facilitiesOptions.clear();
+    clear();
 
     // Steal resources from the moved-from object
     isRunning = other.isRunning;
+    shard = other.shard;
+    shardCount = other.shardCount;
     planCounter = other.planCounter;
+    tick = other.tick;
     actionsLog = move(other.actionsLog);
     plans = move(other.plans);
     settlements = move(other.settlements);
-    facilitiesOptions = move(other.facilitiesOptions);
+    settlementIds = move(other.settlementIds);
+    catalog = other.catalog;
+    visibleCatalog = other.visibleCatalog;
+    forks = move(other.forks);
+    views = move(other.views);
+
+    // Plans still point at the moved-from tables
+    bindPlans();
 
     // Reset the moved-from object
     other.isRunning = false;
     other.planCounter = 0;
+    other.tick = 0;
 
     return *this;
 }
 
 // Destructor 
  Simulation::~Simulation() {
+    delete runner;
+    clear();
+}
+
+// Point every plan and fork at this simulation's tables
+void Simulation::bindPlans() {
+    for (auto &plan : plans) {
+        plan.bindTables(settlements, visibleCatalog);
+    }
+    for (auto &fork : forks) {
+        fork.second->bindTables(settlements, visibleCatalog);
+    }
+}
+
+// Let plans see the facilities added since the last command or step. Called only
+// between them, so a plan never sees the catalog change in the middle of a selection.
+void Simulation::publishCatalog() {
+    if (!visibleCatalog.isSameVersion(catalog)) {
+        visibleCatalog = catalog;
+    }
+}
+
+// Release all owned resources and empty every table
+void Simulation::clear() {
+    // Plans reference the settlement table, drop them first
+    for (auto &fork : forks) {
+        delete fork.second;
+    }
+    forks.clear();
+    plans.clear();
+
     for (auto* settlement : settlements) {
         delete settlement;
     }
     settlements.clear();
-
+    settlementIds.clear();
 
     for (auto* action : actionsLog) {
         delete action;
     }
     actionsLog.clear();
 
-
+    catalog = FacilityCatalog();
+    visibleCatalog = FacilityCatalog();
+    views = PlanViews();
+    generation++;
 }
 
 
 // Start the simulation loop
 void Simulation::start() {
     open(); // Indicates that the simulation is running
+    MetricsServer::publish(*this);
 
     while (isRunning) { // As long as we didn't command 'close'
         string line;
@@ -217,72 +289,196 @@ void Simulation::start() {
         }
         
         getline(cin, line); // Read the entire line of input from the user
+        executeLine(line);
+    }
+}
 
-        vector<string> args = Auxiliary::parseArguments(line);
-        if (args.empty()) continue; // Skip empty input
-
-        BaseAction *action = nullptr;
-
-        // Match the first argument (command) with its corresponding action
-        try {
-            if (args[0] == "settlement") {
-                if (args.size() != 3) throw runtime_error("Invalid settlement command");
-                action = new AddSettlement(args[1], static_cast<SettlementType>(stoi(args[2])));
-            } 
-            else if (args[0] == "facility") {
-                if (args.size() != 7) throw runtime_error("Invalid facility command");
-                action = new AddFacility(args[1], static_cast<FacilityCategory>(stoi(args[2])), stoi(args[3]),
-                                         stoi(args[4]), stoi(args[5]), stoi(args[6]));
-            } 
-            else if (args[0] == "plan") {
-                if (args.size() != 3) throw runtime_error("Invalid plan command");
-                action = new AddPlan(args[1], args[2]);
-            } 
-            else if (args[0] == "step") {
-                if (args.size() != 2) throw runtime_error("Invalid step command");
-                action = new SimulateStep(stoi(args[1]));
-            } 
-            else if (args[0] == "planStatus") {
-                if (args.size() != 2) throw runtime_error("Invalid planStatus command");
-                action = new PrintPlanStatus(stoi(args[1]));
-            } 
-            else if (args[0] == "changePolicy") {
-                if (args.size() != 3) throw runtime_error("Invalid changePolicy command");
-                action = new ChangePlanPolicy(stoi(args[1]), args[2]);
-            } 
-            else if (args[0] == "log") {
-                action = new PrintActionsLog();
-            } 
-            else if (args[0] == "close") {
-                action = new Close();
-            } 
-            else if (args[0] == "backup") {
-                action = new BackupSimulation();
-            } 
-            else if (args[0] == "restore") {
-                action = new RestoreSimulation();
-            } 
-            else {
-                throw runtime_error("Unknown command");
-            }
+// Parse one command line and execute it, printing an error if it is invalid or fails.
+// Returns the action added to the log, or null if nothing was logged.
+const BaseAction *Simulation::executeLine(const string &line) {
+    vector<string> args = Auxiliary::parseArguments(line);
+    if (args.empty()) return nullptr; // Skip empty input
 
-            // If action was created, execute it and add it to the log
-            if (action) {
-                action->act(*this);
-                addAction(action);
-            }
-        } 
-        catch (const exception &e) {
-            // Print error message
-            if (action) delete action; // Clean up memory if an action was created but not added
-            cout << "Error: " << e.what() << endl;
+    BaseAction *action = nullptr;
+
+    try {
+        {
+            MemoryScope scope(MemoryTag::ACTIONS_LOG);
+            action = parseAction(args);
         }
+
+        // If action was created, execute it and add it to the log
+        if (action) {
+            execute(action, args[0]);
+        }
+        return action;
+    } 
+    catch (const exception &e) {
+        if (!action) Stats::add(Stats::PARSE_ERRORS);
+        // Print error message
+        if (action) delete action; // Clean up memory if an action was created but not added
+        cout << "Error: " << e.what() << endl;
+        return nullptr;
+    }
+}
+
+// Execute a parsed action and add it to the log. If the action throws, it is not logged
+// and the caller still owns it.
+void Simulation::execute(BaseAction *action, const string &command) {
+    TraceSpan span(command.c_str(), "command");
+    RunPause pause(*this);
+    uint64_t start = Stats::now();
+    action->act(*this);
+    record(action, command, Stats::now() - start);
+}
+
+// Count and log an action that has already acted, then publish what it changed. Only the
+// command loop calls this, even when the action ran on another thread (see TenantHost).
+void Simulation::record(BaseAction *action, const string &command, uint64_t nanos) {
+    Stats::recordCommand(command, nanos, action->getStatus() == ActionStatus::ERROR);
+    MemoryScope scope(MemoryTag::ACTIONS_LOG);
+    addAction(action);
+    publishCatalog();
+    MetricsServer::publish(*this);
+    if (publishing) {
+        StateView::publish(*this);
     }
 }
 
-// Add a plan to the simulation
-void Simulation::addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy) {
-    plans.emplace_back(planCounter++, settlement, selectionPolicy, facilitiesOptions);
+// Match the first argument (command) with its corresponding action
+BaseAction *Simulation::parseAction(const vector<string> &args) {
+    if (args[0] == "settlement") {
+        if (args.size() != 3) throw runtime_error("Invalid settlement command");
+        return new AddSettlement(args[1], static_cast<SettlementType>(stoi(args[2])));
+    } 
+    else if (args[0] == "facility") {
+        if (args.size() != 7) throw runtime_error("Invalid facility command");
+        return new AddFacility(args[1], static_cast<FacilityCategory>(stoi(args[2])), stoi(args[3]),
+                               stoi(args[4]), stoi(args[5]), stoi(args[6]));
+    } 
+    else if (args[0] == "plan") {
+        if (args.size() != 3) throw runtime_error("Invalid plan command");
+        return new AddPlan(args[1], args[2]);
+    } 
+    else if (args[0] == "step") {
+        // step <n> [--async]
+        if (args.size() == 3 && args[2] == "--async") return new SimulateStep(stoi(args[1]), true);
+        if (args.size() != 2) throw runtime_error("Invalid step command");
+        return new SimulateStep(stoi(args[1]));
+    } 
+    else if (args[0] == "planStatus") {
+        // planStatus <planId> [--since <tick> | --changes]
+        if (args.size() == 4 && args[2] == "--since" && stoi(args[3]) >= 0) return new PrintPlanStatus(stoi(args[1]), stoi(args[3]));
+        if (args.size() == 3 && args[2] == "--changes") return new PrintPlanStatus(stoi(args[1]), PrintPlanStatus::SINCE_LAST_REPORT);
+        if (args.size() != 2) throw runtime_error("Invalid planStatus command");
+        return new PrintPlanStatus(stoi(args[1]));
+    } 
+    else if (args[0] == "changePolicy") {
+        if (args.size() != 3) throw runtime_error("Invalid changePolicy command");
+        return new ChangePlanPolicy(stoi(args[1]), args[2]);
+    } 
+    else if (args[0] == "log") {
+        return new PrintActionsLog();
+    } 
+    else if (args[0] == "close") {
+        return new Close();
+    } 
+    else if (args[0] == "backup") {
+        if (args.size() > 2) throw runtime_error("Invalid backup command");
+        return new BackupSimulation(args.size() == 2 ? args[1] : "");
+    } 
+    else if (args[0] == "restore") {
+        if (args.size() == 3 && args[1] == "--step") return new RestoreSimulation(stoi(args[2]));
+        if (args.size() > 2) throw runtime_error("Invalid restore command");
+        return new RestoreSimulation(args.size() == 2 ? args[1] : "");
+    } 
+    else if (args[0] == "snapshots") {
+        return new PrintSnapshots();
+    } 
+    else if (args[0] == "sweep") {
+        if (args.size() != 2) throw runtime_error("Invalid sweep command");
+        return new PolicySweep(stoi(args[1]));
+    } 
+    else if (args[0] == "fork") {
+        if (args.size() != 2) throw runtime_error("Invalid fork command");
+        return new ForkPlan(stoi(args[1]));
+    } 
+    else if (args[0] == "forkStep") {
+        if (args.size() != 3) throw runtime_error("Invalid forkStep command");
+        return new StepFork(stoi(args[1]), stoi(args[2]));
+    } 
+    else if (args[0] == "forkPolicy") {
+        if (args.size() != 3) throw runtime_error("Invalid forkPolicy command");
+        return new ChangeForkPolicy(stoi(args[1]), args[2]);
+    } 
+    else if (args[0] == "forkStatus") {
+        if (args.size() != 2) throw runtime_error("Invalid forkStatus command");
+        return new PrintForkStatus(stoi(args[1]));
+    } 
+    else if (args[0] == "commit") {
+        if (args.size() != 2) throw runtime_error("Invalid commit command");
+        return new CommitFork(stoi(args[1]));
+    } 
+    else if (args[0] == "discard") {
+        if (args.size() != 2) throw runtime_error("Invalid discard command");
+        return new DiscardFork(stoi(args[1]));
+    } 
+    else if (args[0] == "top") {
+        if (args.size() != 3) throw runtime_error("Invalid top command");
+        return new PrintTopPlans(args[1], stoi(args[2]));
+    } 
+    else if (args[0] == "aggregate") {
+        if (args.size() > 2) throw runtime_error("Invalid aggregate command");
+        return new PrintAggregates(args.size() == 2 ? args[1] : "");
+    } 
+    else if (args[0] == "stats") {
+        if (args.size() != 1) throw runtime_error("Invalid stats command");
+        return new PrintStats();
+    } 
+    else if (args[0] == "scores") {
+        if (args.size() != 1) throw runtime_error("Invalid scores command");
+        return new PrintScores();
+    } 
+    else if (args[0] == "progress") {
+        if (args.size() != 1) throw runtime_error("Invalid progress command");
+        return new PrintProgress();
+    } 
+    else if (args[0] == "cancel") {
+        if (args.size() != 1) throw runtime_error("Invalid cancel command");
+        return new CancelRun();
+    } 
+    else if (args[0] == "mem") {
+        if (args.size() != 1) throw runtime_error("Invalid mem command");
+        return new PrintMemory();
+    } 
+    else if (args[0] == "plans") {
+        // plans [where <condition> ...]
+        if (args.size() == 2 || (args.size() > 2 && args[1] != "where")) throw runtime_error("Invalid plans command");
+        return new QueryPlans(vector<string>(args.begin() + min<size_t>(2, args.size()), args.end()));
+    } 
+    else if (args[0] == "schedule") {
+        // schedule <planId> <steps> <window> [<lifeWeight> <ecoWeight> <envWeight>] [<budgetMs>]
+        if (args.size() != 4 && args.size() != 5 && args.size() != 7 && args.size() != 8) throw runtime_error("Invalid schedule command");
+        bool weighted = args.size() >= 7;
+        bool budgeted = args.size() == 5 || args.size() == 8;
+        return new SearchPolicySchedule(stoi(args[1]), stoi(args[2]), stoi(args[3]),
+                                        weighted ? stoi(args[4]) : 1, weighted ? stoi(args[5]) : 1, weighted ? stoi(args[6]) : 1,
+                                        budgeted ? stoi(args.back()) : 1000);
+    } 
+    throw runtime_error("Unknown command");
+}
+
+// Add a plan to the simulation (references to existing plans stay valid)
+void Simulation::addPlan(const size_t settlementId, SelectionPolicy *selectionPolicy) {
+    if (planCounter % shardCount != shard) {
+        // Another shard owns this plan id; keep numbering in step with it
+        delete selectionPolicy;
+        planCounter++;
+        return;
+    }
+    plans.emplace_back(planCounter++, settlementId, settlements, selectionPolicy, visibleCatalog);
+    plans.back().startChangeLog(tick);
+    views.addPlan(plans.back());
 }
 
 // Add a new action to the log
@@ -290,40 +486,49 @@ void Simulation::addAction(BaseAction *action) {
     actionsLog.push_back(action);
 }
 
+// Make room for that many more settlements, plans and logged actions (the catalog
+// grows in chunks of its own). Tables that must grow at least double, so
+// reserving batch after batch stays amortized.
+void Simulation::reserve(size_t settlementCount, size_t planCount, size_t actionCount) {
+    auto grow = [](size_t needed, size_t capacity) { return needed > capacity ? max(needed, 2 * capacity) : 0; };
+    if (size_t size = grow(settlements.size() + settlementCount, settlements.capacity())) {
+        settlements.reserve(size);
+    }
+    if (size_t size = grow(settlementIds.size() + settlementCount, settlementIds.bucket_count() * settlementIds.max_load_factor())) {
+        settlementIds.reserve(size);
+    }
+    if (size_t size = grow(actionsLog.size() + actionCount, actionsLog.capacity())) {
+        actionsLog.reserve(size);
+    }
+    views.reserve(planCounter + planCount);
+}
+
 // Add a settlement to the simulation
 bool Simulation::addSettlement(Settlement *settlement) {
+    settlementIds[settlement->getName()] = settlements.size();
     settlements.push_back(settlement);
     return true;
 }
 
-// Add a facility type to the simulations
+// Add a facility type to the simulation: the catalog moves to a version with one more
+// type, which plans see once the current command or step is over
 bool Simulation::addFacility(FacilityType facility) {
-    facilitiesOptions.push_back(facility);
+    catalog.append(facility);
     return true;
 }
 
 // Check if a settlement exists in the simulation
-bool Simulation::isSettlementExists(const string &settlementName) {
-    for (size_t i = 0; i < settlements.size(); i++) {
-        if (settlements[i]->getName() == settlementName) {
-            return true; 
-        }
-    }
-    return false; 
+bool Simulation::isSettlementExists(const string &settlementName) const {
+    return settlementIds.find(settlementName) != settlementIds.end();
 }
 
 // Check if a type of facility exists in the simulation
 bool Simulation::isFacilityExists(const string &facilityName) {
-    for (size_t i = 0; i < facilitiesOptions.size(); ++i) {
-        if (facilitiesOptions[i].getName() == facilityName) {
-            return true; 
-        }
-    }
-    return false; 
+    return catalog.contains(facilityName);
 }
 
 // Check if a plan exists in the simulation
-bool Simulation::isPlanExists(const int planId) {
+bool Simulation::isPlanExists(const int planId) const {
     for (size_t i = 0; i < plans.size(); ++i) {
         if (plans[i].getPlanId() == planId) {
             return true; 
@@ -334,12 +539,21 @@ bool Simulation::isPlanExists(const int planId) {
 
 // Get a settlement by name
 Settlement &Simulation::getSettlement(const string &settlementName) {
-    for (auto *s : settlements) {
-        if (s->getName() == settlementName) {
-            return *s;
-        }
+    return *settlements[getSettlementId(settlementName)];
+}
+
+// Get a settlement's index in the settlement table by name
+size_t Simulation::getSettlementId(const string &settlementName) const {
+    auto it = settlementIds.find(settlementName);
+    if (it == settlementIds.end()) {
+        throw runtime_error("Settlement not found");
     }
-    throw runtime_error("Settlement not found");
+    return it->second;
+}
+
+// Get a settlement's name by its index in the settlement table
+const string &Simulation::getSettlementName(size_t settlementId) const {
+    return settlements[settlementId]->getName();
 }
 
 // Get a plan by ID
@@ -352,20 +566,148 @@ Plan &Simulation::getPlan(const int planID) {
     throw runtime_error("Plan not found");
 }
 
+const Plan &Simulation::getPlan(const int planID) const {
+    for (const auto &plan : plans) {
+        if (plan.getPlanId() == planID) {
+            return plan;
+        }
+    }
+    throw runtime_error("Plan not found");
+}
+
+// Get all plans (read-only).
+const deque<Plan> &Simulation::getPlans() const {
+    return plans;
+}
+
+// What planStatus prints for a plan
+const string Simulation::getPlanDetails(const int planId) const {
+    return getPlan(planId).toString();
+}
+
+// Check if a plan has an open fork
+bool Simulation::isForked(const int planId) const {
+    return forks.find(planId) != forks.end();
+}
+
+// Open a fork: a copy of one plan that shares its settlement and the facility options
+Plan &Simulation::forkPlan(const int planId) {
+    if (isForked(planId)) {
+        throw runtime_error("Plan already forked");
+    }
+    MemoryScope scope(MemoryTag::PLANS);
+    Plan *fork = new Plan(getPlan(planId));
+    forks[planId] = fork;
+    return *fork;
+}
+
+// Get the open fork of a plan
+Plan &Simulation::getFork(const int planId) {
+    auto it = forks.find(planId);
+    if (it == forks.end()) {
+        throw runtime_error("Plan is not forked");
+    }
+    return *it->second;
+}
+
+// Replace a plan with its fork, keeping the plan's change history
+void Simulation::commitFork(const int planId) {
+    Plan &fork = getFork(planId);
+    Plan &plan = getPlan(planId);
+    plan.adopt(fork);
+    views.updatePolicy(plan);
+    discardFork(planId);
+}
+
+// Drop a plan's fork
+void Simulation::discardFork(const int planId) {
+    delete &getFork(planId);
+    forks.erase(planId);
+}
+
+// Replace a plan's selection policy
+void Simulation::changePlanPolicy(const int planId, SelectionPolicy *selectionPolicy) {
+    Plan &plan = getPlan(planId);
+    plan.setSelectionPolicy(selectionPolicy);
+    views.updatePolicy(plan);
+}
+
+// Get the plan rankings and totals (read-only).
+const PlanViews &Simulation::getViews() const {
+    return views;
+}
+
 // Get the action log (read-only).
 const std::vector<BaseAction*>& Simulation::getActionsLog() const {
     return actionsLog;
 }
 
+size_t Simulation::getLogSize() const {
+    return actionsLog.size();
+}
+
+const string Simulation::getLogLine(size_t index) const {
+    return actionsLog[index]->toString();
+}
+
+// Get the number of steps simulated so far
+int Simulation::getTick() const {
+    return tick;
+}
+
+uint64_t Simulation::getGeneration() const {
+    return generation;
+}
+
+size_t Simulation::getSettlementCount() const {
+    return settlements.size();
+}
+
+size_t Simulation::getFacilityTypeCount() const {
+    return catalog.size();
+}
+
+// Get the newest version of the facility types (read-only, shared)
+const FacilityCatalog &Simulation::getCatalog() const {
+    return catalog;
+}
+
 // Perform one simulation step by advancing all plans.
 void Simulation::step() {
+    TraceSpan span("step", "simulation", tick + 1);
+    MemoryScope scope(MemoryTag::PLANS);
+    uint64_t start = Stats::now();
+    publishCatalog();
+    tick++;
+    PlanStepCounts total = {0, 0};
     for (auto &plan : plans) {
-        plan.step();
+        plan.setTick(tick);
+        PlanStepCounts counts = plan.step();
+        plan.setTick(tick + 1); // Commands until the next step change the plan as of that step
+        views.updateState(plan);
+        total.started += counts.started;
+        total.completed += counts.completed;
+        if (counts.started > 0) {
+            Stats::add(plan.getSelectionPolicy()->getSelectionCounter(), counts.started); // One selection per start
+        }
+    }
+    // What-if copies (sweep, schedule, forks) step plans directly and are not counted
+    Stats::add(Stats::FACILITIES_STARTED, total.started);
+    Stats::add(Stats::FACILITIES_COMPLETED, total.completed);
+    if (telemetry != nullptr) {
+        telemetry->sample(*this);
+    }
+    Stats::recordStep(Stats::now() - start);
+    if (publishing) {
+        StateView::publishTick(*this);
     }
 }
 
 // Print results of all plans and stop the simulation
 void Simulation::close() {
+    if (runner != nullptr) {
+        runner->cancel();
+    }
     for (const auto& plan : plans) {
         cout << "PlanID: " << plan.getPlanId() << "\n";
         cout << "SettlementName: " << plan.getSettlement().getName() << "\n";
@@ -387,4 +729,58 @@ void Simulation::open() {
     cout << "The simulation has started" << endl;
 }
 
+// Publish a StateView after every step and command, for readers on other threads
+void Simulation::setPublishing(bool enabled) {
+    publishing = enabled;
+    if (publishing) {
+        StateView::publish(*this);
+    }
+}
+
+// Sample steps into the telemetry file, or stop (null). Waits for a background tick in progress.
+void Simulation::setTelemetry(Telemetry *telemetry) {
+    RunPause pause(*this);
+    this->telemetry = telemetry;
+}
+
+// Step numOfSteps ticks on a background thread; commands pause it between ticks
+void Simulation::runAsync(const int numOfSteps) {
+    if (runner == nullptr) throw runtime_error("This simulation cannot run in the background");
+    runner->start(numOfSteps);
+}
+
+// Keep only the plans this shard owns (ids equal to shard modulo shardCount); plans
+// added later are numbered as usual but only created by their owner
+void Simulation::keepShard(int shard, int shardCount) {
+    this->shard = shard;
+    this->shardCount = shardCount;
+    deque<Plan> owned;
+    for (const Plan &plan : plans) {
+        if (plan.getPlanId() % shardCount == shard) {
+            owned.emplace_back(plan, settlements, visibleCatalog);
+        }
+    }
+    for (auto it = forks.begin(); it != forks.end();) {
+        if (it->first % shardCount != shard) {
+            delete it->second;
+            it = forks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    plans.swap(owned);
+    views.rebuild(plans);
+    generation++;
+}
+
+// The background runner, or null for copies
+StepRunner *Simulation::getRunner() const {
+    return runner;
+}
+
+// Whether the simulation is running (between open and close)
+bool Simulation::isOpen() const {
+    return isRunning;
+}
+
     
\ No newline at end of file
@@ -0,0 +1,326 @@
+#include "Snapshot.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Trace.h"
+#include "Memory.h"
+
+#include <cstring>
+#include <unordered_map>
+
+// No rule of 3 needed - the image is a plain byte buffer.
+
+// Image layout (every record is made of 32-bit fields, so records stay aligned):
+//   ImageHeader | SettlementRecord[] | FacilityTypeRecord[] | PlanRecord[] | FacilityRecord[] | LogRecord[] | string pool
+// Operational facilities of all plans come before all under-construction ones, so the
+// rarely changing records stay together and consecutive images differ in few places.
+namespace {
+
+const uint32_t IMAGE_MAGIC = 0x53504c31; // "SPL1"
+const size_t MAX_IMAGE_SIZE = UINT32_MAX; // Offsets and counts are 32-bit
+
+enum PolicyKind : int32_t { NAIVE, BALANCED, ECONOMY, SUSTAINABILITY };
+
+struct StringRef {
+    uint32_t offset; // Relative to the start of the string pool
+    uint32_t length;
+};
+
+struct ImageHeader {
+    uint32_t magic;
+    int32_t planCounter;
+    int32_t tick;
+    uint32_t settlementCount, facilityTypeCount, planCount, facilityCount, logCount;
+    uint32_t settlementsOffset, facilityTypesOffset, plansOffset, facilitiesOffset, logOffset, stringsOffset;
+};
+
+struct SettlementRecord {
+    StringRef name;
+    int32_t type;
+};
+
+struct FacilityTypeRecord {
+    StringRef name;
+    int32_t category, price, lifeQualityScore, economyScore, environmentScore;
+};
+
+struct PlanRecord {
+    int32_t planId;
+    uint32_t settlementId;
+    int32_t status;
+    int32_t lifeQualityScore, economyScore, environmentScore;
+    int32_t policyKind;
+    int32_t policyState[3]; // lastSelectedIndex, or the three balanced scores
+    uint32_t firstOperational, operationalCount;
+    uint32_t firstUnderConstruction, underConstructionCount;
+};
+
+struct FacilityRecord {
+    uint32_t typeId; // Index into the facility type table
+    int32_t status;
+    int32_t timeLeft;
+};
+
+struct LogRecord {
+    StringRef line; // The action's toString(), re-parsed on restore
+};
+
+template <typename T>
+void put(vector<char> &image, size_t offset, const T &record) {
+    memcpy(image.data() + offset, &record, sizeof(T));
+}
+
+template <typename T>
+T get(const vector<char> &image, size_t offset) {
+    T record;
+    memcpy(&record, image.data() + offset, sizeof(T));
+    return record;
+}
+
+} // namespace
+
+// Constructor: serializes the simulation into a single buffer
+Snapshot::Snapshot(const Simulation &simulation) : image() {
+    // Facilities are stored as an index into the facility type table
+    unordered_map<string, uint32_t> typeIds;
+    const FacilityCatalog &facilityTypes = simulation.catalog;
+    for (size_t i = 0; i < facilityTypes.size(); i++) {
+        typeIds[facilityTypes[i].getName()] = i;
+    }
+    size_t operationalCount = 0;
+    size_t underConstructionCount = 0;
+    for (const Plan &plan : simulation.plans) {
+        operationalCount += plan.facilities.size();
+        underConstructionCount += plan.underConstruction.size();
+    }
+
+    ImageHeader header;
+    header.magic = IMAGE_MAGIC;
+    header.planCounter = simulation.planCounter;
+    header.tick = simulation.tick;
+    header.settlementCount = simulation.settlements.size();
+    header.facilityTypeCount = facilityTypes.size();
+    header.planCount = simulation.plans.size();
+    header.facilityCount = operationalCount + underConstructionCount;
+    header.logCount = simulation.actionsLog.size();
+    // Laid out in size_t first: the 32-bit fields would silently wrap
+    size_t settlementsOffset = sizeof(ImageHeader);
+    size_t facilityTypesOffset = settlementsOffset + simulation.settlements.size() * sizeof(SettlementRecord);
+    size_t plansOffset = facilityTypesOffset + facilityTypes.size() * sizeof(FacilityTypeRecord);
+    size_t facilitiesOffset = plansOffset + simulation.plans.size() * sizeof(PlanRecord);
+    size_t logOffset = facilitiesOffset + (operationalCount + underConstructionCount) * sizeof(FacilityRecord);
+    size_t stringsOffset = logOffset + simulation.actionsLog.size() * sizeof(LogRecord);
+    if (stringsOffset > MAX_IMAGE_SIZE) {
+        throw runtime_error("Snapshot image is too large");
+    }
+    header.settlementsOffset = settlementsOffset;
+    header.facilityTypesOffset = facilityTypesOffset;
+    header.plansOffset = plansOffset;
+    header.facilitiesOffset = facilitiesOffset;
+    header.logOffset = logOffset;
+    header.stringsOffset = stringsOffset;
+
+    image.resize(header.stringsOffset);
+    put(image, 0, header);
+
+    // Appends a string to the pool and returns its reference
+    auto addString = [this, &header](const string &str) {
+        if (image.size() + str.size() > MAX_IMAGE_SIZE) {
+            throw runtime_error("Snapshot image is too large");
+        }
+        StringRef ref = {static_cast<uint32_t>(image.size() - header.stringsOffset), static_cast<uint32_t>(str.size())};
+        image.insert(image.end(), str.begin(), str.end());
+        return ref;
+    };
+
+    for (size_t i = 0; i < header.settlementCount; i++) {
+        const Settlement *settlement = simulation.settlements[i];
+        SettlementRecord record = {addString(settlement->getName()), static_cast<int32_t>(settlement->getType())};
+        put(image, header.settlementsOffset + i * sizeof(SettlementRecord), record);
+    }
+
+    for (size_t i = 0; i < header.facilityTypeCount; i++) {
+        const FacilityType &type = facilityTypes[i];
+        FacilityTypeRecord record = {addString(type.getName()), static_cast<int32_t>(type.getCategory()), type.getCost(),
+                                     type.getLifeQualityScore(), type.getEconomyScore(), type.getEnvironmentScore()};
+        put(image, header.facilityTypesOffset + i * sizeof(FacilityTypeRecord), record);
+    }
+
+    size_t nextOperational = 0;
+    size_t nextUnderConstruction = operationalCount;
+    size_t planIndex = 0;
+    for (const Plan &plan : simulation.plans) {
+        PlanRecord record;
+        record.planId = plan.plan_id;
+        record.settlementId = plan.settlementId;
+        record.status = static_cast<int32_t>(plan.status);
+        record.lifeQualityScore = plan.life_quality_score;
+        record.economyScore = plan.economy_score;
+        record.environmentScore = plan.environment_score;
+        record.policyState[0] = record.policyState[1] = record.policyState[2] = 0;
+
+        const SelectionPolicy *policy = plan.selectionPolicy;
+        if (const NaiveSelection *naive = dynamic_cast<const NaiveSelection*>(policy)) {
+            record.policyKind = NAIVE;
+            record.policyState[0] = naive->lastSelectedIndex;
+        } else if (const BalancedSelection *balanced = dynamic_cast<const BalancedSelection*>(policy)) {
+            record.policyKind = BALANCED;
+            record.policyState[0] = balanced->LifeQualityScore;
+            record.policyState[1] = balanced->EconomyScore;
+            record.policyState[2] = balanced->EnvironmentScore;
+        } else if (const EconomySelection *economy = dynamic_cast<const EconomySelection*>(policy)) {
+            record.policyKind = ECONOMY;
+            record.policyState[0] = economy->lastSelectedIndex;
+        } else {
+            const SustainabilitySelection *sustainability = dynamic_cast<const SustainabilitySelection*>(policy);
+            record.policyKind = SUSTAINABILITY;
+            record.policyState[0] = sustainability->lastSelectedIndex;
+        }
+
+        record.firstOperational = nextOperational;
+        record.operationalCount = plan.facilities.size();
+        record.firstUnderConstruction = nextUnderConstruction;
+        record.underConstructionCount = plan.underConstruction.size();
+        put(image, header.plansOffset + planIndex++ * sizeof(PlanRecord), record);
+
+        for (const Facility *facility : plan.facilities) {
+            FacilityRecord facilityRecord = {typeIds[facility->getName()], static_cast<int32_t>(facility->status), facility->timeLeft};
+            put(image, header.facilitiesOffset + nextOperational++ * sizeof(FacilityRecord), facilityRecord);
+        }
+        for (const Facility *facility : plan.underConstruction) {
+            FacilityRecord facilityRecord = {typeIds[facility->getName()], static_cast<int32_t>(facility->status), facility->timeLeft};
+            put(image, header.facilitiesOffset + nextUnderConstruction++ * sizeof(FacilityRecord), facilityRecord);
+        }
+    }
+
+    for (size_t i = 0; i < header.logCount; i++) {
+        LogRecord record = {addString(simulation.actionsLog[i]->toString())};
+        put(image, header.logOffset + i * sizeof(LogRecord), record);
+    }
+}
+
+// Constructor: wraps an existing image
+Snapshot::Snapshot(const vector<char> &image) : image(image) {}
+
+// Rebuilds the simulation's state from the image
+void Snapshot::restore(Simulation &simulation) const {
+    TraceSpan span("restoreSnapshot", "snapshot");
+    const ImageHeader header = get<ImageHeader>(image, 0);
+    if (header.magic != IMAGE_MAGIC) {
+        throw runtime_error("Corrupt snapshot image");
+    }
+    const char *pool = image.data() + header.stringsOffset;
+    auto readString = [pool](const StringRef &ref) {
+        return string(pool + ref.offset, ref.length);
+    };
+
+    FacilityCatalog previous = simulation.catalog; // Found again below if the types did not change
+    simulation.clear();
+    simulation.planCounter = header.planCounter;
+    simulation.tick = header.tick;
+
+    {
+        MemoryScope scope(MemoryTag::SETTLEMENTS);
+        simulation.settlements.reserve(header.settlementCount);
+        for (size_t i = 0; i < header.settlementCount; i++) {
+            SettlementRecord record = get<SettlementRecord>(image, header.settlementsOffset + i * sizeof(SettlementRecord));
+            simulation.addSettlement(new Settlement(readString(record.name), static_cast<SettlementType>(record.type)));
+        }
+    }
+
+    {
+        MemoryScope scope(MemoryTag::FACILITY_TYPES);
+        vector<FacilityType> facilityTypes;
+        facilityTypes.reserve(header.facilityTypeCount);
+        for (size_t i = 0; i < header.facilityTypeCount; i++) {
+            FacilityTypeRecord record = get<FacilityTypeRecord>(image, header.facilityTypesOffset + i * sizeof(FacilityTypeRecord));
+            facilityTypes.push_back(FacilityType(readString(record.name), static_cast<FacilityCategory>(record.category),
+                                                 record.price, record.lifeQualityScore, record.economyScore, record.environmentScore));
+        }
+        // Back to the shared catalog if another simulation still has these types
+        simulation.catalog = FacilityCatalog::intern(facilityTypes);
+        simulation.visibleCatalog = simulation.catalog;
+    }
+    const FacilityCatalog &facilityTypes = simulation.visibleCatalog;
+
+    MemoryScope plansScope(MemoryTag::PLANS);
+    for (size_t i = 0; i < header.planCount; i++) {
+        PlanRecord record = get<PlanRecord>(image, header.plansOffset + i * sizeof(PlanRecord));
+
+        SelectionPolicy *policy = nullptr;
+        switch (record.policyKind) {
+            case NAIVE: {
+                NaiveSelection *naive = new NaiveSelection();
+                naive->lastSelectedIndex = record.policyState[0];
+                policy = naive;
+                break;
+            }
+            case BALANCED:
+                policy = new BalancedSelection(record.policyState[0], record.policyState[1], record.policyState[2]);
+                break;
+            case ECONOMY: {
+                EconomySelection *economy = new EconomySelection();
+                economy->lastSelectedIndex = record.policyState[0];
+                policy = economy;
+                break;
+            }
+            default: {
+                SustainabilitySelection *sustainability = new SustainabilitySelection();
+                sustainability->lastSelectedIndex = record.policyState[0];
+                policy = sustainability;
+                break;
+            }
+        }
+
+        simulation.plans.emplace_back(record.planId, record.settlementId, simulation.settlements, policy, facilityTypes);
+        Plan &plan = simulation.plans.back();
+        plan.status = static_cast<PlanStatus>(record.status);
+        plan.life_quality_score = record.lifeQualityScore;
+        plan.economy_score = record.economyScore;
+        plan.environment_score = record.environmentScore;
+        plan.startChangeLog(header.tick); // The change log is not part of the image
+
+        const string &settlementName = plan.getSettlement().getName();
+        auto readFacilities = [&](uint32_t first, uint32_t count, vector<Facility*> &list, MemoryTag tag) {
+            list.reserve(count);
+            for (uint32_t j = first; j < first + count; j++) {
+                FacilityRecord facilityRecord = get<FacilityRecord>(image, header.facilitiesOffset + j * sizeof(FacilityRecord));
+                MemoryScope scope(tag);
+                Facility *facility = new Facility(facilityTypes[facilityRecord.typeId], settlementName);
+                facility->status = static_cast<FacilityStatus>(facilityRecord.status);
+                facility->timeLeft = facilityRecord.timeLeft;
+                list.push_back(facility);
+            }
+        };
+        readFacilities(record.firstOperational, record.operationalCount, plan.facilities, MemoryTag::FACILITIES_OPERATIONAL);
+        readFacilities(record.firstUnderConstruction, record.underConstructionCount, plan.underConstruction, MemoryTag::FACILITIES_UNDER_CONSTRUCTION);
+    }
+
+    // Log entries are stored as their printed form: "<command> <args...> <STATUS>"
+    {
+        MemoryScope scope(MemoryTag::ACTIONS_LOG);
+        simulation.actionsLog.reserve(header.logCount);
+        for (size_t i = 0; i < header.logCount; i++) {
+            LogRecord record = get<LogRecord>(image, header.logOffset + i * sizeof(LogRecord));
+            vector<string> args = Auxiliary::parseArguments(readString(record.line));
+            string status = args.back();
+            args.pop_back();
+            BaseAction *action = Simulation::parseAction(args);
+            if (status == "COMPLETED") {
+                action->status = ActionStatus::COMPLETED;
+            }
+            simulation.actionsLog.push_back(action);
+        }
+    }
+
+    simulation.views.rebuild(simulation.plans);
+}
+
+// Get the raw image
+const vector<char> &Snapshot::getImage() const {
+    return image;
+}
+
+// Size of the image in bytes
+size_t Snapshot::size() const {
+    return image.size();
+}
@@ -0,0 +1,345 @@
+#include "SnapshotStore.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "Memory.h"
+
+#include <cstring>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+// No rule of 3 needed - entries own their buffers by value.
+
+// Delta format: varint(targetSize) followed by a sequence of operations
+//   'C' varint(baseOffset) varint(length)   copy bytes from the base image
+//   'I' varint(length) <bytes>              insert literal bytes
+// Matches are found rsync-style: the base image is indexed by block hash and the
+// target is scanned with a rolling hash, so shifted records are still matched.
+namespace {
+
+const size_t BLOCK_SIZE = 16;
+const uint64_t HASH_BASE = 1099511628211ULL;
+
+void putVarint(vector<char> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t getVarint(const vector<char> &in, size_t &pos) {
+    uint64_t value = 0;
+    int shift = 0;
+    while (true) {
+        uint8_t byte = static_cast<uint8_t>(in.at(pos++));
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+        shift += 7;
+    }
+}
+
+uint64_t hashBlock(const char *data) {
+    uint64_t hash = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        hash = hash * HASH_BASE + static_cast<uint8_t>(data[i]);
+    }
+    return hash;
+}
+
+// Emits an insert operation for target[from, to) if it is not empty
+void putLiteral(vector<char> &delta, const vector<char> &target, size_t from, size_t to) {
+    if (from == to) return;
+    delta.push_back('I');
+    putVarint(delta, to - from);
+    delta.insert(delta.end(), target.begin() + from, target.begin() + to);
+}
+
+} // namespace
+
+// Constructor
+SnapshotStore::SnapshotStore() : entries(), lastImage(), sinceKeyframe(0) {}
+
+// Takes a snapshot of the simulation and stores it under the given name
+void SnapshotStore::save(const string &name, const Simulation &simulation) {
+    TraceSpan span("saveSnapshot", "snapshot");
+    MemoryScope scope(MemoryTag::SNAPSHOTS);
+    Snapshot snapshot(simulation);
+    const vector<char> &image = snapshot.getImage();
+
+    // A reused name now refers to the new snapshot
+    int previous = find(name);
+    if (previous >= 0) {
+        drop(previous);
+    }
+
+    size_t logHash = 0;
+    for (const BaseAction *action : simulation.getActionsLog()) {
+        logHash = hashLine(logHash, action->toString());
+    }
+    Entry entry = {name, simulation.getTick(), simulation.getActionsLog().size(), logHash, true, image.size(), vector<char>()};
+    if (!entries.empty() && sinceKeyframe + 1 < KEYFRAME_INTERVAL) {
+        vector<char> delta = encodeDelta(lastImage, image);
+        // Fall back to a keyframe when most of the image changed anyway
+        if (delta.size() < image.size() / 2) {
+            entry.keyframe = false;
+            entry.data = move(delta);
+        }
+    }
+    if (entry.keyframe) {
+        entry.data = image;
+        sinceKeyframe = 0;
+    } else {
+        sinceKeyframe++;
+    }
+
+    Stats::add(Stats::SNAPSHOTS);
+    Stats::add(Stats::SNAPSHOT_IMAGE_BYTES, image.size());
+    Stats::add(Stats::SNAPSHOT_STORED_BYTES, entry.data.size());
+    entries.push_back(move(entry));
+    lastImage = image;
+}
+
+// Check if a snapshot with this name exists
+bool SnapshotStore::contains(const string &name) const {
+    return find(name) >= 0;
+}
+
+// Restore the simulation from the snapshot with this name
+void SnapshotStore::restore(const string &name, Simulation &simulation) const {
+    int index = find(name);
+    if (index < 0) {
+        throw runtime_error("Snapshot not found");
+    }
+    decode(index).restore(simulation);
+}
+
+// Rewind to the last state the simulation had at the tick: restore the latest snapshot
+// of the current history taken at or before it, then re-execute the logged commands
+// that followed, up to the step that went past the tick
+void SnapshotStore::restoreToTick(int tick, Simulation &simulation) const {
+    if (tick > simulation.getTick()) {
+        throw runtime_error("Cannot restore to a later step");
+    }
+    // A snapshot is part of the current history if its log starts the current one
+    const vector<BaseAction*> &log = simulation.getActionsLog();
+    vector<size_t> prefixHashes(1, 0);
+    for (const BaseAction *action : log) {
+        prefixHashes.push_back(hashLine(prefixHashes.back(), action->toString()));
+    }
+    int best = -1;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry &entry = entries[i];
+        if (entry.tick <= tick && entry.logCount <= log.size() && prefixHashes[entry.logCount] == entry.logHash &&
+            (best < 0 || entry.logCount >= entries[best].logCount)) {
+            best = i;
+        }
+    }
+    if (best < 0) {
+        throw runtime_error("No snapshot at or before this step");
+    }
+    for (size_t i = entries[best].logCount; i < log.size(); i++) {
+        const SimulateStep *step = dynamic_cast<const SimulateStep*>(log[i]);
+        if (step != nullptr && step->isAsync()) {
+            throw runtime_error("Cannot replay a background run; restore a snapshot taken after it");
+        }
+    }
+
+    // Copied before the restore replaces the log
+    vector<BaseAction*> later;
+    for (size_t i = entries[best].logCount; i < log.size(); i++) {
+        later.push_back(log[i]->clone());
+    }
+    decode(best).restore(simulation);
+    replay(later, tick, simulation);
+}
+
+// Re-executes the logged commands that change the simulation, silently, and logs every
+// command again. Stops at the step that would go past the tick, running only the part of
+// it that reaches the tick. The others (queries, reports, schedule and sweep, which only
+// try things out on copies, backups and restores) are logged but not executed: a restore
+// in the log is always preceded by the history of the snapshot it restored.
+void SnapshotStore::replay(const vector<BaseAction*> &actions, int tick, Simulation &simulation) {
+    ostringstream discarded;
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+    size_t next = 0;
+    for (; next < actions.size(); next++) {
+        BaseAction *action = actions[next];
+        if (const SimulateStep *step = dynamic_cast<const SimulateStep*>(action)) {
+            int remaining = tick - simulation.getTick();
+            if (remaining == 0) break;
+            if (step->getNumOfSteps() > remaining) {
+                action = new SimulateStep(remaining);
+                delete actions[next++];
+                action->act(simulation);
+                simulation.addAction(action);
+                break;
+            }
+        }
+        if (action->changesState()) {
+            try {
+                action->act(simulation);
+            } catch (const exception &e) {
+                // It did not throw the first time; leave it out rather than stop halfway
+                delete action;
+                continue;
+            }
+        }
+        simulation.addAction(action);
+    }
+    for (; next < actions.size(); next++) {
+        delete actions[next];
+    }
+    cout.rdbuf(console);
+}
+
+// Total bytes held by all stored keyframes and deltas
+size_t SnapshotStore::getStoredBytes() const {
+    size_t total = 0;
+    for (const Entry &entry : entries) {
+        total += entry.data.size();
+    }
+    return total;
+}
+
+// Lists the named snapshots, oldest first
+const string SnapshotStore::toString() const {
+    ostringstream oss;
+    for (const Entry &entry : entries) {
+        if (entry.name.empty()) continue;
+        oss << "Snapshot: " << entry.name << "\n";
+        oss << "Tick: " << entry.tick << "\n";
+        oss << "Type: " << (entry.keyframe ? "KEYFRAME" : "DELTA") << "\n";
+        oss << "StoredBytes: " << entry.data.size() << " of " << entry.imageSize << "\n";
+    }
+    oss << "TotalStoredBytes: " << getStoredBytes() << "\n";
+    return oss.str();
+}
+
+// Rebuilds the full image of an entry from its keyframe and the deltas after it
+Snapshot SnapshotStore::decode(size_t index) const {
+    TraceSpan span("decodeSnapshot", "snapshot");
+    size_t keyframe = index;
+    while (!entries[keyframe].keyframe) {
+        keyframe--;
+    }
+    vector<char> image = entries[keyframe].data;
+    for (size_t i = keyframe + 1; i <= index; i++) {
+        image = applyDelta(image, entries[i].data);
+    }
+    return Snapshot(image);
+}
+
+// Removes an entry. The entry after it is re-encoded against the one before it, or
+// becomes a keyframe if the removed entry was one.
+void SnapshotStore::drop(size_t index) {
+    if (index + 1 < entries.size() && !entries[index + 1].keyframe) {
+        vector<char> image = decode(index + 1).getImage();
+        Entry &next = entries[index + 1];
+        if (entries[index].keyframe) {
+            next.keyframe = true;
+            next.data = move(image);
+        } else {
+            next.data = encodeDelta(decode(index - 1).getImage(), image);
+        }
+    }
+    entries.erase(entries.begin() + index);
+    if (index == entries.size()) {
+        // The newest entry went; the next delta is taken against the one before it
+        lastImage = entries.empty() ? vector<char>() : decode(entries.size() - 1).getImage();
+    }
+    sinceKeyframe = 0;
+    for (size_t i = entries.size(); i > 0 && !entries[i - 1].keyframe; i--) {
+        sinceKeyframe++;
+    }
+}
+
+// Combines the hash of a log with one more of its lines
+size_t SnapshotStore::hashLine(size_t hash, const string &line) {
+    return hash * HASH_BASE ^ std::hash<string>()(line);
+}
+
+// Index of the newest entry with this name, or -1
+int SnapshotStore::find(const string &name) const {
+    for (int i = static_cast<int>(entries.size()) - 1; i >= 0; i--) {
+        if (entries[i].name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Encodes target as copy/insert operations against base
+vector<char> SnapshotStore::encodeDelta(const vector<char> &base, const vector<char> &target) {
+    vector<char> delta;
+    putVarint(delta, target.size());
+
+    // Index every aligned block of the base image by its hash
+    unordered_map<uint64_t, size_t> blocks;
+    for (size_t offset = 0; offset + BLOCK_SIZE <= base.size(); offset += BLOCK_SIZE) {
+        blocks.emplace(hashBlock(base.data() + offset), offset);
+    }
+
+    // Weight of the byte leaving the rolling window
+    uint64_t outWeight = 1;
+    for (size_t i = 1; i < BLOCK_SIZE; i++) {
+        outWeight *= HASH_BASE;
+    }
+
+    size_t literalStart = 0;
+    size_t pos = 0;
+    uint64_t hash = 0;
+    bool hashValid = false;
+    while (pos + BLOCK_SIZE <= target.size()) {
+        if (!hashValid) {
+            hash = hashBlock(target.data() + pos);
+            hashValid = true;
+        }
+        auto it = blocks.find(hash);
+        if (it != blocks.end() && memcmp(base.data() + it->second, target.data() + pos, BLOCK_SIZE) == 0) {
+            // Extend the match as far as both images agree
+            size_t from = it->second;
+            size_t length = BLOCK_SIZE;
+            while (pos + length < target.size() && from + length < base.size() && target[pos + length] == base[from + length]) {
+                length++;
+            }
+            putLiteral(delta, target, literalStart, pos);
+            delta.push_back('C');
+            putVarint(delta, from);
+            putVarint(delta, length);
+            pos += length;
+            literalStart = pos;
+            hashValid = false;
+        } else {
+            if (pos + BLOCK_SIZE < target.size()) {
+                hash = (hash - static_cast<uint8_t>(target[pos]) * outWeight) * HASH_BASE + static_cast<uint8_t>(target[pos + BLOCK_SIZE]);
+            }
+            pos++;
+        }
+    }
+    putLiteral(delta, target, literalStart, target.size());
+    return delta;
+}
+
+// Rebuilds the target image from base and a delta produced by encodeDelta
+vector<char> SnapshotStore::applyDelta(const vector<char> &base, const vector<char> &delta) {
+    size_t pos = 0;
+    vector<char> target;
+    target.reserve(getVarint(delta, pos));
+    while (pos < delta.size()) {
+        char op = delta[pos++];
+        if (op == 'C') {
+            size_t from = getVarint(delta, pos);
+            size_t length = getVarint(delta, pos);
+            target.insert(target.end(), base.begin() + from, base.begin() + from + length);
+        } else {
+            size_t length = getVarint(delta, pos);
+            target.insert(target.end(), delta.begin() + pos, delta.begin() + pos + length);
+            pos += length;
+        }
+    }
+    return target;
+}
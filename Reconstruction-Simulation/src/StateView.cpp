@@ -0,0 +1,177 @@
+#include "StateView.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "Epoch.h"
+#include "Memory.h"
+
+#include <sstream>
+#include <stdexcept>
+
+// No rule of 3 needed - all members manage themselves.
+
+namespace {
+
+Published<StateView> published;
+
+} // namespace
+
+// Constructor: captures the whole simulation
+StateView::StateView(const Simulation &simulation) : StateView(simulation, nullptr, true) {}
+
+// Constructor: captures the simulation, sharing what did not change with the previous view.
+// Plan details, rankings, settlements and the log are only refreshed once a command is done.
+StateView::StateView(const Simulation &simulation, const StateView *previous, bool commandDone)
+    : tick(simulation.getTick()), generation(simulation.getGeneration()), plans(), views(), viewsStale(false),
+      settlements(), log() {
+    if (previous != nullptr && previous->generation != generation) {
+        previous = nullptr; // The tables were replaced (e.g. by a restore)
+    }
+    bool changed = previous == nullptr;
+    const deque<Plan> &simulationPlans = simulation.getPlans();
+    if (!simulationPlans.empty()) {
+        plans.resize(simulationPlans.back().getPlanId() + 1);
+    }
+    for (const Plan &plan : simulationPlans) {
+        int planId = plan.getPlanId();
+        const PlanState *old = nullptr;
+        if (previous != nullptr && static_cast<size_t>(planId) < previous->plans.size()) {
+            old = previous->plans[planId].get();
+        }
+        if (old != nullptr && old->revision == plan.getRevision() && (!commandDone || old->detailsRevision == old->revision)) {
+            plans[planId] = previous->plans[planId];
+            continue;
+        }
+        changed = true;
+        shared_ptr<const string> details;
+        size_t detailsRevision = 0;
+        if (commandDone || old == nullptr) {
+            details = std::make_shared<const string>(plan.toString());
+            detailsRevision = plan.getRevision();
+        } else {
+            details = old->details;
+            detailsRevision = old->detailsRevision;
+        }
+        plans[planId] = std::make_shared<const PlanState>(PlanState{planId, plan.getSettlement().getName(), plan.getStatus(),
+                                  plan.getSelectionPolicy()->toString(), plan.getlifeQualityScore(),
+                                  plan.getEconomyScore(), plan.getEnvironmentScore(),
+                                  plan.getFacilities().size(), plan.getFacilitiesUnderConstruction().size(),
+                                  plan.getRevision(), details, detailsRevision});
+    }
+    if (previous != nullptr && previous->plans.size() != plans.size()) {
+        changed = true;
+    }
+
+    if (previous == nullptr || (commandDone && (changed || previous->viewsStale))) {
+        views = std::make_shared<const PlanViews>(simulation.getViews());
+    } else {
+        views = previous->views;
+        viewsStale = changed || previous->viewsStale;
+    }
+
+    if (previous == nullptr || (commandDone && previous->settlements->names.size() != simulation.getSettlementCount())) {
+        shared_ptr<Settlements> names = std::make_shared<Settlements>();
+        for (size_t id = 0; id < simulation.getSettlementCount(); id++) {
+            names->names.push_back(simulation.getSettlementName(id));
+            names->ids[names->names.back()] = id;
+        }
+        settlements = names;
+    } else {
+        settlements = previous->settlements;
+    }
+
+    if (previous != nullptr) {
+        log = previous->log;
+    }
+    if (commandDone || previous == nullptr) {
+        const vector<BaseAction*> &actionsLog = simulation.getActionsLog();
+        for (size_t i = log.size(); i < actionsLog.size(); i++) {
+            log.append(actionsLog[i]->toString());
+        }
+    }
+}
+
+int StateView::getTick() const {
+    return tick;
+}
+
+bool StateView::isPlanExists(const int planId) const {
+    return planId >= 0 && static_cast<size_t>(planId) < plans.size() && plans[planId] != nullptr;
+}
+
+// The plan's full status as of the last command
+const string StateView::getPlanDetails(const int planId) const {
+    if (!isPlanExists(planId)) {
+        throw runtime_error("Plan not found");
+    }
+    return *plans[planId]->details;
+}
+
+const PlanViews &StateView::getViews() const {
+    return *views;
+}
+
+bool StateView::isSettlementExists(const string &settlementName) const {
+    return settlements->ids.find(settlementName) != settlements->ids.end();
+}
+
+size_t StateView::getSettlementId(const string &settlementName) const {
+    auto it = settlements->ids.find(settlementName);
+    if (it == settlements->ids.end()) {
+        throw runtime_error("Settlement not found");
+    }
+    return it->second;
+}
+
+const string &StateView::getSettlementName(size_t settlementId) const {
+    return settlements->names[settlementId];
+}
+
+size_t StateView::getLogSize() const {
+    return log.size();
+}
+
+const string StateView::getLogLine(size_t index) const {
+    return log[index];
+}
+
+// Indexed by plan id; null for ids without a plan
+const vector<shared_ptr<const PlanState>> &StateView::getPlans() const {
+    return plans;
+}
+
+// Report printed by the scores command
+const string StateView::toString() const {
+    std::ostringstream oss;
+    oss << "Tick: " << tick << "\n";
+    for (const shared_ptr<const PlanState> &plan : plans) {
+        if (plan == nullptr) continue;
+        oss << "PlanID: " << plan->planId
+            << " SettlementName: " << plan->settlementName
+            << " PlanStatus: " << (plan->status == PlanStatus::AVALIABLE ? "AVAILABLE" : "BUSY")
+            << " SelectionPolicy: " << plan->policy
+            << " LifeQualityScore: " << plan->lifeQualityScore
+            << " EconomyScore: " << plan->economyScore
+            << " EnvironmentScore: " << plan->environmentScore
+            << " Operational: " << plan->operational
+            << " UnderConstruction: " << plan->underConstruction << "\n";
+    }
+    return oss.str();
+}
+
+// Replaces the latest view after a command; the previous one is freed once no reader holds it.
+// Only the publishing thread replaces views, so it can read the latest one without a guard.
+void StateView::publish(const Simulation &simulation) {
+    MemoryScope scope(MemoryTag::SNAPSHOTS);
+    published.publish(new StateView(simulation, published.get(), true));
+}
+
+// Replaces the latest view after a tick, refreshing only the plans' statuses and scores
+void StateView::publishTick(const Simulation &simulation) {
+    MemoryScope scope(MemoryTag::SNAPSHOTS);
+    published.publish(new StateView(simulation, published.get(), false));
+}
+
+// The latest published view, or null before the first publish. Hold an EpochGuard while using it.
+const StateView *StateView::latest() {
+    return published.get();
+}
@@ -0,0 +1,169 @@
+#include "Stats.h"
+#include "Memory.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+// No rule of 3 needed - histograms are not copyable and the statistics live for the whole run.
+
+namespace {
+
+// Zero-initialized before any dynamic initialization, so operator new may count from the start
+atomic<uint64_t> counters[Stats::NUM_OF_COUNTERS];
+
+LatencyHistogram stepLatency;
+
+// Commands in order of first use. Entries are only appended, by the command loop,
+// and become visible to readers when commandCount is raised.
+Stats::CommandStats commands[Stats::MAX_COMMANDS];
+atomic<size_t> commandCount(0);
+
+// Formats nanoseconds as microseconds
+string micros(uint64_t nanos) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(1) << nanos / 1000.0 << "us";
+    return oss.str();
+}
+
+} // namespace
+
+// Constructor
+LatencyHistogram::LatencyHistogram() : buckets(), count(0), sum(0), max(0) {
+    for (int bucket = 0; bucket < NUM_OF_BUCKETS; bucket++) {
+        buckets[bucket].store(0, std::memory_order_relaxed);
+    }
+}
+
+// Bucket b holds latencies below 2^(b+1) nanoseconds
+void LatencyHistogram::record(uint64_t nanos) {
+    int bucket = 0;
+    while (bucket < NUM_OF_BUCKETS - 1 && nanos >= bucketLimit(bucket)) {
+        bucket++;
+    }
+    buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(nanos, std::memory_order_relaxed);
+    uint64_t previous = max.load(std::memory_order_relaxed);
+    while (nanos > previous && !max.compare_exchange_weak(previous, nanos, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::getCount() const {
+    return count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getSum() const {
+    return sum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getMax() const {
+    return max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::getBucket(int bucket) const {
+    return buckets[bucket].load(std::memory_order_relaxed);
+}
+
+// Exclusive upper bound of a bucket in nanoseconds
+uint64_t LatencyHistogram::bucketLimit(int bucket) {
+    return bucket >= NUM_OF_BUCKETS - 1 ? UINT64_MAX : static_cast<uint64_t>(2) << bucket;
+}
+
+// Upper bound of the bucket holding the given fraction of the samples, capped at the maximum
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    uint64_t total = getCount();
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(fraction * total);
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < NUM_OF_BUCKETS; bucket++) {
+        seen += getBucket(bucket);
+        if (seen > rank) {
+            uint64_t limit = bucketLimit(bucket) - 1;
+            return limit < getMax() ? limit : getMax();
+        }
+    }
+    return getMax();
+}
+
+const string LatencyHistogram::toString() const {
+    std::ostringstream oss;
+    oss << "Count: " << getCount() << " P50: " << micros(percentile(0.5)) << " P99: " << micros(percentile(0.99))
+        << " Max: " << micros(getMax());
+    return oss.str();
+}
+
+void Stats::add(Counter counter, uint64_t amount) {
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+uint64_t Stats::get(Counter counter) {
+    return counters[counter].load(std::memory_order_relaxed);
+}
+
+// Records one simulation step (also called from worker threads stepping copies)
+void Stats::recordStep(uint64_t nanos) {
+    add(STEPS);
+    stepLatency.record(nanos);
+}
+
+// Records one executed command; only called from the command loop
+void Stats::recordCommand(const string &command, uint64_t nanos, bool failed) {
+    size_t count = commandCount.load(std::memory_order_relaxed);
+    size_t index = 0;
+    while (index < count && commands[index].name != command) {
+        index++;
+    }
+    if (index == count) {
+        if (count == MAX_COMMANDS) return;
+        commands[index].name = command;
+        commandCount.store(count + 1, std::memory_order_release);
+    }
+    CommandStats &stats = commands[index];
+    if (failed) {
+        stats.errors.fetch_add(1, std::memory_order_relaxed);
+    }
+    stats.latency.record(nanos);
+}
+
+const LatencyHistogram &Stats::getStepLatency() {
+    return stepLatency;
+}
+
+// Calls visit for every command executed so far, in order of first use
+void Stats::forEachCommand(const function<void(const CommandStats&)> &visit) {
+    size_t count = commandCount.load(std::memory_order_acquire);
+    for (size_t index = 0; index < count; index++) {
+        visit(commands[index]);
+    }
+}
+
+// Monotonic time in nanoseconds
+uint64_t Stats::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Report printed by the stats command and written by --stats-file
+const string Stats::toString() {
+    std::ostringstream oss;
+    oss << "Steps: " << get(STEPS) << "\n";
+    oss << "StepLatency: " << stepLatency.toString() << "\n";
+    oss << "FacilitiesStarted: " << get(FACILITIES_STARTED) << "\n";
+    oss << "FacilitiesCompleted: " << get(FACILITIES_COMPLETED) << "\n";
+    oss << "Selections: nve=" << get(SELECTIONS_NAIVE) << " bal=" << get(SELECTIONS_BALANCED)
+        << " eco=" << get(SELECTIONS_ECONOMY) << " sus=" << get(SELECTIONS_SUSTAINABILITY) << "\n";
+    oss << "Allocations: " << Memory::getAllocations() << " (" << Memory::getAllocatedBytes() << " bytes)\n";
+    oss << "Snapshots: " << get(SNAPSHOTS) << " ImageBytes: " << get(SNAPSHOT_IMAGE_BYTES)
+        << " StoredBytes: " << get(SNAPSHOT_STORED_BYTES) << "\n";
+    oss << "ParseErrors: " << get(PARSE_ERRORS) << "\n";
+    std::vector<const CommandStats*> sorted;
+    forEachCommand([&sorted](const CommandStats &stats) { sorted.push_back(&stats); });
+    std::sort(sorted.begin(), sorted.end(), [](const CommandStats *a, const CommandStats *b) { return a->name < b->name; });
+    for (const CommandStats *stats : sorted) {
+        oss << "Command: " << stats->name << " Errors: " << stats->errors.load(std::memory_order_relaxed)
+            << " " << stats->latency.toString() << "\n";
+    }
+    return oss.str();
+}
@@ -0,0 +1,108 @@
+#include "StepRunner.h"
+#include "Simulation.h"
+#include "Stats.h"
+
+#include <sstream>
+#include <stdexcept>
+
+// Rule of 3: copying is deleted, the destructor cancels the run and joins the worker.
+
+// Constructor
+StepRunner::StepRunner(Simulation &simulation)
+    : simulation(simulation), lock(), resumed(), pauses(0), pauseRequests(0), cancelling(false),
+      state(RunState::IDLE), ticksDone(0), ticksRequested(0), startNanos(0), endNanos(0), worker() {}
+
+// Destructor
+StepRunner::~StepRunner() {
+    cancel();
+}
+
+// Starts stepping numOfSteps ticks in the background
+void StepRunner::start(int numOfSteps) {
+    if (isActive()) throw std::runtime_error("A background run is already in progress");
+    if (worker.joinable()) worker.join();
+    ticksDone.store(0);
+    ticksRequested = numOfSteps;
+    startNanos = Stats::now();
+    endNanos.store(0);
+    state.store(RunState::RUNNING);
+    worker = thread(&StepRunner::run, this, numOfSteps);
+}
+
+// Stops the run at the next tick boundary and waits for it; returns the ticks it completed.
+// Safe to call while the caller holds a RunPause.
+int StepRunner::cancel() {
+    if (worker.joinable()) {
+        cancelling.store(true);
+        {
+            // Taking the lock means the worker is either mid-tick or waiting, so the wakeup can't be missed
+            std::lock_guard<mutex> guard(lock);
+        }
+        resumed.notify_all();
+        worker.join();
+        cancelling.store(false);
+    }
+    return ticksDone.load();
+}
+
+// Whether a run is still stepping
+bool StepRunner::isActive() const {
+    return state.load() == RunState::RUNNING;
+}
+
+// Report printed by the progress command
+const string StepRunner::progress() const {
+    RunState current = state.load();
+    if (current == RunState::IDLE) return "No background run\n";
+    int done = ticksDone.load();
+    uint64_t end = current == RunState::RUNNING ? Stats::now() : endNanos.load();
+    double seconds = (end - startNanos) / 1e9;
+    std::ostringstream oss;
+    oss << "Run: " << (current == RunState::RUNNING ? "RUNNING" : current == RunState::FINISHED ? "FINISHED" : "CANCELLED")
+        << " Ticks: " << done << "/" << ticksRequested
+        << " TicksPerSecond: " << (seconds > 0 ? done / seconds : 0.0)
+        << " Tick: " << simulation.getTick() << "\n";
+    return oss.str();
+}
+
+// Worker thread: one tick per iteration, holding the lock for the whole tick
+void StepRunner::run(int numOfSteps) {
+    int done = 0;
+    while (done < numOfSteps) {
+        std::unique_lock<mutex> guard(lock);
+        resumed.wait(guard, [this] { return cancelling.load() || (pauses == 0 && pauseRequests.load() == 0); });
+        if (cancelling.load()) break;
+        simulation.step();
+        ticksDone.store(++done);
+    }
+    endNanos.store(Stats::now());
+    state.store(done == numOfSteps ? RunState::FINISHED : RunState::CANCELLED);
+}
+
+// Waits for the tick in progress, then holds the worker until resume()
+void StepRunner::pause() {
+    // Announce first, so the worker yields at the next tick boundary instead of taking the lock again
+    pauseRequests.fetch_add(1);
+    std::lock_guard<mutex> guard(lock);
+    pauses++;
+    pauseRequests.fetch_sub(1);
+}
+
+// Lets the worker continue once no pause is left
+void StepRunner::resume() {
+    {
+        std::lock_guard<mutex> guard(lock);
+        pauses--;
+    }
+    resumed.notify_all();
+}
+
+// Constructor: pauses the simulation's background run, if it has one
+RunPause::RunPause(const Simulation &simulation) : runner(simulation.getRunner()) {
+    if (runner != nullptr) runner->pause();
+}
+
+// Destructor
+RunPause::~RunPause() {
+    if (runner != nullptr) runner->resume();
+}
@@ -0,0 +1,179 @@
+#include "Telemetry.h"
+#include "Simulation.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// Rule of 3: copying is deleted, the destructor writes what is left and joins the writer.
+
+namespace {
+
+const uint32_t FORMAT_VERSION = 1;
+
+void putFixed(vector<uint8_t> &out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// LEB128: seven bits per byte, low bits first, high bit set on all but the last byte
+void putVarint(vector<uint8_t> &out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Zigzag first, so small negative deltas stay short too
+void putSigned(vector<uint8_t> &out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void putColumn(vector<uint8_t> &out, const vector<uint8_t> &column) {
+    putVarint(out, column.size());
+    out.insert(out.end(), column.begin(), column.end());
+}
+
+void write(ofstream &file, const vector<uint8_t> &bytes) {
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+} // namespace
+
+// Constructor: writes the header and starts the writer thread
+Telemetry::Telemetry(const string &path, int interval)
+    : file(path, std::ios::binary | std::ios::trunc), interval(interval), buffers(), filling(&buffers[0]), full(nullptr),
+      finishing(false), lock(), handedOver(), written(), index(), offset(0), writer() {
+    if (!file.is_open()) {
+        throw runtime_error("Unable to open telemetry file");
+    }
+    vector<uint8_t> header = {'R', 'S', 'T', 'M'};
+    putFixed(header, FORMAT_VERSION, 4);
+    putFixed(header, interval, 4);
+    write(file, header);
+    offset = header.size();
+    writer = thread(&Telemetry::run, this);
+}
+
+// Destructor
+Telemetry::~Telemetry() {
+    finish();
+}
+
+// Called after every step: every interval ticks, copies each plan's row into the
+// filling buffer, and hands the buffer to the writer once a block is full
+void Telemetry::sample(const Simulation &simulation) {
+    int tick = simulation.getTick();
+    if (tick % interval != 0) return;
+    const deque<Plan> &plans = simulation.getPlans();
+    filling->ticks.push_back(tick);
+    filling->rowCounts.push_back(plans.size());
+    for (const Plan &plan : plans) {
+        filling->rows.push_back(plan.getPlanId());
+        filling->rows.push_back(static_cast<int>(plan.getStatus()));
+        filling->rows.push_back(plan.getlifeQualityScore());
+        filling->rows.push_back(plan.getEconomyScore());
+        filling->rows.push_back(plan.getEnvironmentScore());
+        filling->rows.push_back(plan.getFacilitiesUnderConstruction().size());
+    }
+    if (filling->ticks.size() < SAMPLES_PER_BLOCK && filling->rows.size() < ROWS_PER_BLOCK * COLUMNS) return;
+
+    std::lock_guard<mutex> guard(lock);
+    if (full != nullptr) return; // Still writing the other buffer
+    full = filling;
+    filling = filling == &buffers[0] ? &buffers[1] : &buffers[0];
+    handedOver.notify_one();
+}
+
+// Writes what is left, the index and the trailer, then stops the writer. The caller
+// makes sure no step samples any more. Returns whether the whole file was written.
+bool Telemetry::finish() {
+    if (!writer.joinable()) return file.good();
+    {
+        std::unique_lock<mutex> guard(lock);
+        written.wait(guard, [this] { return full == nullptr; });
+        if (!filling->ticks.empty()) {
+            full = filling;
+        }
+        finishing = true;
+        handedOver.notify_one();
+    }
+    writer.join();
+
+    vector<uint8_t> footer;
+    for (const BlockEntry &entry : index) {
+        putFixed(footer, entry.lowestTick, 8);
+        putFixed(footer, entry.highestTick, 8);
+        putFixed(footer, entry.offset, 8);
+        putFixed(footer, entry.length, 8);
+    }
+    putFixed(footer, offset, 8);
+    putFixed(footer, index.size(), 8);
+    footer.insert(footer.end(), {'R', 'S', 'T', 'I'});
+    write(file, footer);
+    file.close();
+    return !file.fail();
+}
+
+// Writer thread: writes each buffer it is handed, then empties it for reuse
+void Telemetry::run() {
+    std::unique_lock<mutex> guard(lock);
+    while (true) {
+        handedOver.wait(guard, [this] { return full != nullptr || finishing; });
+        if (full == nullptr) break;
+        Batch *batch = full;
+        guard.unlock();
+        writeBlock(*batch);
+        batch->ticks.clear();
+        batch->rowCounts.clear();
+        batch->rows.clear();
+        guard.lock();
+        full = nullptr;
+        written.notify_all();
+    }
+}
+
+// Encodes one buffer as a block and records it in the index
+void Telemetry::writeBlock(const Batch &batch) {
+    vector<uint8_t> block;
+    vector<uint8_t> column;
+    size_t rowCount = batch.rows.size() / COLUMNS;
+    putVarint(block, batch.ticks.size());
+    putVarint(block, rowCount);
+
+    int64_t previousTick = 0;
+    for (int tick : batch.ticks) {
+        putSigned(column, tick - previousTick);
+        previousTick = tick;
+    }
+    putColumn(block, column);
+    column.clear();
+    for (uint32_t count : batch.rowCounts) {
+        putVarint(column, count);
+    }
+    putColumn(block, column);
+
+    for (int c = 0; c < COLUMNS; c++) {
+        column.clear();
+        size_t start = 0;
+        size_t previousStart = 0;
+        for (size_t s = 0; s < batch.rowCounts.size(); s++) {
+            for (size_t r = 0; r < batch.rowCounts[s]; r++) {
+                int64_t reference = 0;
+                if (s > 0 && r < batch.rowCounts[s - 1]) {
+                    reference = batch.rows[(previousStart + r) * COLUMNS + c];
+                }
+                putSigned(column, batch.rows[(start + r) * COLUMNS + c] - reference);
+            }
+            previousStart = start;
+            start += batch.rowCounts[s];
+        }
+        putColumn(block, column);
+    }
+
+    write(file, block);
+    auto range = std::minmax_element(batch.ticks.begin(), batch.ticks.end());
+    index.push_back(BlockEntry{*range.first, *range.second, offset, block.size()});
+    offset += block.size();
+}
@@ -0,0 +1,203 @@
+#include "TenantHost.h"
+#include "Simulation.h"
+#include "Action.h"
+#include "SnapshotStore.h"
+#include "Stats.h"
+#include "MetricsServer.h"
+#include "Memory.h"
+#include "Trace.h"
+
+#include <stdexcept>
+
+// Rule of 3: copying is deleted, the destructor deletes the tenants it loaded and their backups.
+
+namespace {
+
+// Commands that would step a tenant on a thread of its own
+bool isBackground(const vector<string> &args) {
+    if (args[0] == "progress" || args[0] == "cancel") return true;
+    return args[0] == "step" && find(args.begin(), args.end(), "--async") != args.end();
+}
+
+} // namespace
+
+// Constructor: loads every tenant after the first; stepping threads start right away
+TenantHost::TenantHost(Simulation &first, const string &firstConfigPath, const vector<string> &configPaths)
+    : first(first), tenants(), pool(ThreadPool::defaultSize()) {
+    tenants.push_back(Tenant{&first, firstConfigPath, nullptr});
+    try {
+        for (const string &path : configPaths) {
+            tenants.push_back(Tenant{new Simulation(path), path, nullptr});
+        }
+    } catch (...) {
+        for (size_t i = 1; i < tenants.size(); i++) {
+            delete tenants[i].simulation;
+        }
+        throw;
+    }
+}
+
+// Destructor
+TenantHost::~TenantHost() {
+    pool.wait();
+    for (size_t i = 0; i < tenants.size(); i++) {
+        if (i > 0) delete tenants[i].simulation;
+        delete tenants[i].snapshots;
+    }
+}
+
+// Command loop: runs stdin's commands until every tenant is closed or the input ends
+void TenantHost::run() {
+    first.open();
+    ostringstream discarded; // Every tenant announces itself; once is enough
+    streambuf *console = cout.rdbuf(discarded.rdbuf());
+    for (size_t i = 1; i < tenants.size(); i++) {
+        tenants[i].simulation->open();
+    }
+    cout.rdbuf(console);
+    MetricsServer::publish(first);
+
+    string line;
+    while (isOpen() && getline(cin, line)) {
+        dispatch(line);
+    }
+}
+
+// Routes one command line to one tenant or to all of them
+void TenantHost::dispatch(const string &line) {
+    vector<string> args = Auxiliary::parseArguments(line);
+    if (args.empty()) return;
+    if (args.size() == 1 && args[0] == "tenants") {
+        printTenants();
+        return;
+    }
+
+    Tenant *target = nullptr;
+    string command = line;
+    if (args[0][0] == '@') {
+        size_t id = tenants.size();
+        try {
+            id = stoul(args[0].substr(1));
+        } catch (const exception &e) {}
+        if (id >= tenants.size()) {
+            Stats::add(Stats::PARSE_ERRORS);
+            cout << "Error: Tenant not found" << endl;
+            return;
+        }
+        target = &tenants[id];
+        command = line.substr(line.find(args[0]) + args[0].size());
+        args.erase(args.begin());
+        if (args.empty()) return;
+    }
+
+    try {
+        delete Simulation::parseAction(args); // Reject invalid commands once, not once per tenant
+    } catch (const exception &e) {
+        Stats::add(Stats::PARSE_ERRORS);
+        cout << "Error: " << e.what() << endl;
+        return;
+    }
+    if (isBackground(args)) {
+        cout << "Error: " << command << " is not available with tenants" << endl;
+    } else if (target != nullptr) {
+        if (!target->simulation->isOpen()) {
+            cout << "Error: Tenant " << (target - &tenants[0]) << " is closed" << endl;
+            return;
+        }
+        executeOn(*target, command);
+    } else if (args[0] == "step") {
+        stepEvery(command);
+    } else {
+        executeOnEvery(command);
+    }
+}
+
+// Runs a command on one tenant, with that tenant's backups in place
+void TenantHost::executeOn(Tenant &tenant, const string &line) {
+    snapshots = tenant.snapshots;
+    tenant.simulation->executeLine(line);
+    tenant.snapshots = snapshots;
+    snapshots = nullptr;
+}
+
+// Runs a command on every open tenant in turn, heading each one's output with its id
+void TenantHost::executeOnEvery(const string &line) {
+    for (size_t i = 0; i < tenants.size(); i++) {
+        if (!tenants[i].simulation->isOpen()) continue;
+        ostringstream output;
+        streambuf *console = cout.rdbuf(output.rdbuf());
+        executeOn(tenants[i], line);
+        cout.rdbuf(console);
+        if (output.tellp() > 0) {
+            cout << "Tenant " << i << ":\n" << output.str() << flush;
+        }
+    }
+}
+
+// Steps every open tenant at once, one pool task per tenant, and waits for all of them.
+// The pool threads only step; each step command is then counted, logged and published
+// here, in tenant order, since command stats and the log belong to the command loop.
+// Errors are printed afterwards, in tenant order.
+void TenantHost::stepEvery(const string &line) {
+    vector<string> args = Auxiliary::parseArguments(line);
+    vector<BaseAction*> actions(tenants.size(), nullptr);
+    vector<uint64_t> nanos(tenants.size(), 0);
+    vector<string> errors(tenants.size());
+    for (size_t i = 0; i < tenants.size(); i++) {
+        if (!tenants[i].simulation->isOpen()) continue;
+        {
+            MemoryScope scope(MemoryTag::ACTIONS_LOG);
+            actions[i] = Simulation::parseAction(args);
+        }
+        Simulation *simulation = tenants[i].simulation;
+        BaseAction *action = actions[i];
+        string command = args[0];
+        uint64_t *elapsed = &nanos[i];
+        string *error = &errors[i];
+        pool.submit([simulation, action, command, elapsed, error] {
+            TraceSpan span(command.c_str(), "command");
+            uint64_t start = Stats::now();
+            try {
+                action->act(*simulation); // Only steps: plans, views and step counters
+            } catch (const exception &e) {
+                *error = e.what();
+            }
+            *elapsed = Stats::now() - start;
+        });
+    }
+    pool.wait();
+    for (size_t i = 0; i < tenants.size(); i++) {
+        if (actions[i] == nullptr) continue;
+        if (!errors[i].empty()) {
+            delete actions[i];
+            cout << "Tenant " << i << ":\nError: " << errors[i] << endl;
+            continue;
+        }
+        tenants[i].simulation->record(actions[i], args[0], nanos[i]);
+    }
+}
+
+// One line per tenant: where it came from, how far it got and which catalog it uses
+void TenantHost::printTenants() const {
+    for (size_t i = 0; i < tenants.size(); i++) {
+        const Simulation &simulation = *tenants[i].simulation;
+        const FacilityCatalog &catalog = simulation.getCatalog();
+        size_t sharing = 0;
+        for (const Tenant &other : tenants) {
+            if (other.simulation->getCatalog().isSameStore(catalog)) sharing++;
+        }
+        cout << "Tenant " << i << ": " << tenants[i].configPath << ", tick " << simulation.getTick() << ", "
+             << simulation.getPlans().size() << " plans, catalog " << catalog.getStoreId() << " at version " << catalog.size()
+             << " (shared by " << sharing << (sharing == 1 ? " tenant)" : " tenants)")
+             << (simulation.isOpen() ? "" : ", closed") << "\n";
+    }
+    cout << flush;
+}
+
+// Whether any tenant is still open
+bool TenantHost::isOpen() const {
+    for (const Tenant &tenant : tenants) {
+        if (tenant.simulation->isOpen()) return true;
+    }
+    return false;
+}
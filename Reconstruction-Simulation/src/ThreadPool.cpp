@@ -0,0 +1,102 @@
+#include "ThreadPool.h"
+
+// Rule of 3: copying is deleted, the destructor joins the workers.
+
+// Constructor: starts the worker threads
+ThreadPool::ThreadPool(size_t numOfThreads)
+    : workers(), threads(), stateLock(), taskAvailable(), allDone(), queued(0), unfinished(0), stopping(false), nextWorker(0) {
+    if (numOfThreads == 0) numOfThreads = 1;
+    for (size_t i = 0; i < numOfThreads; i++) {
+        workers.push_back(new Worker());
+    }
+    for (size_t i = 0; i < numOfThreads; i++) {
+        threads.emplace_back(&ThreadPool::run, this, i);
+    }
+}
+
+// Destructor: lets queued tasks finish, then stops the workers
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    for (Worker *worker : workers) {
+        delete worker;
+    }
+}
+
+// Queue a task; submissions are spread round-robin over the workers
+void ThreadPool::submit(function<void()> task) {
+    // Count the task before it becomes visible, so a fast worker cannot finish it first
+    {
+        std::lock_guard<std::mutex> guard(stateLock);
+        queued++;
+        unfinished++;
+    }
+    Worker *worker = workers[nextWorker++ % workers.size()];
+    {
+        std::lock_guard<std::mutex> guard(worker->lock);
+        worker->tasks.push_back(move(task));
+    }
+    taskAvailable.notify_one();
+}
+
+// Block until every submitted task has finished
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> guard(stateLock);
+    allDone.wait(guard, [this] { return unfinished == 0; });
+}
+
+// Number of worker threads
+size_t ThreadPool::size() const {
+    return workers.size();
+}
+
+// One worker per hardware thread
+size_t ThreadPool::defaultSize() {
+    size_t cores = std::thread::hardware_concurrency();
+    return cores == 0 ? 1 : cores;
+}
+
+// Worker loop: run own tasks, steal when idle, sleep when every queue is empty
+void ThreadPool::run(size_t index) {
+    while (true) {
+        function<void()> task;
+        if (takeTask(index, task)) {
+            task();
+            std::lock_guard<std::mutex> guard(stateLock);
+            if (--unfinished == 0) {
+                allDone.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(stateLock);
+        taskAvailable.wait(guard, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0) return;
+    }
+}
+
+// Take the newest task of this worker, or steal the oldest task of another one
+bool ThreadPool::takeTask(size_t index, function<void()> &task) {
+    for (size_t i = 0; i < workers.size(); i++) {
+        Worker *worker = workers[(index + i) % workers.size()];
+        std::lock_guard<std::mutex> guard(worker->lock);
+        if (worker->tasks.empty()) continue;
+        if (i == 0) {
+            task = move(worker->tasks.back());
+            worker->tasks.pop_back();
+        } else {
+            task = move(worker->tasks.front());
+            worker->tasks.pop_front();
+        }
+        std::lock_guard<std::mutex> stateGuard(stateLock);
+        queued--;
+        return true;
+    }
+    return false;
+}
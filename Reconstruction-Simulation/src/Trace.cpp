@@ -0,0 +1,113 @@
+#include "Trace.h"
+#include "Stats.h"
+
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+using std::vector;
+
+// No rule of 3 needed - thread buffers are owned by the registry and freed by finish().
+
+namespace {
+
+struct TraceEvent {
+    TraceEvent(const char *name, const char *category, int id, uint64_t startNanos, uint64_t endNanos)
+        : name(name), category(category), id(id), startNanos(startNanos), endNanos(endNanos) {}
+    TraceEvent(const TraceEvent &other) = default;
+    TraceEvent &operator=(const TraceEvent &other) = default;
+    string name;
+    const char *category; // Always a string literal
+    int id;
+    uint64_t startNanos, endNanos;
+};
+
+// Spans recorded by one thread. Only the owning thread appends to it.
+struct ThreadBuffer {
+    explicit ThreadBuffer(int threadId) : threadId(threadId), events() {}
+    int threadId;
+    vector<TraceEvent> events;
+};
+
+string tracePath;
+uint64_t traceStart = 0;
+std::mutex registryLock; // Taken once per thread, when its buffer is created
+vector<ThreadBuffer*> buffers;
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+ThreadBuffer &getThreadBuffer() {
+    if (threadBuffer == nullptr) {
+        std::lock_guard<std::mutex> lock(registryLock);
+        threadBuffer = new ThreadBuffer(buffers.size() + 1);
+        buffers.push_back(threadBuffer);
+    }
+    return *threadBuffer;
+}
+
+// Escapes a string for a JSON string literal
+void writeJsonString(std::ofstream &out, const string &str) {
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+        else out << c;
+    }
+    out << '"';
+}
+
+} // namespace
+
+atomic<bool> Trace::enabled(false);
+
+// Starts recording spans; they are written to the path by finish()
+void Trace::start(const string &path) {
+    tracePath = path;
+    traceStart = Stats::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+// Appends a completed span to the calling thread's buffer
+void Trace::record(const char *name, const char *category, int id, uint64_t startNanos, uint64_t endNanos) {
+    getThreadBuffer().events.emplace_back(name, category, id, startNanos, endNanos);
+}
+
+// Stops tracing and writes every buffer as trace-event JSON. Must be called once the
+// worker threads are done; returns false if the file could not be written.
+bool Trace::finish() {
+    if (!enabled.exchange(false)) return true;
+    std::ofstream out(tracePath);
+    out << std::fixed << std::setprecision(3);
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (ThreadBuffer *buffer : buffers) {
+        for (const TraceEvent &event : buffer->events) {
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"" << event.category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->threadId
+                << ",\"ts\":" << (event.startNanos - traceStart) / 1000.0
+                << ",\"dur\":" << (event.endNanos - event.startNanos) / 1000.0;
+            if (event.id >= 0) {
+                out << ",\"args\":{\"id\":" << event.id << "}";
+            }
+            out << "}";
+            first = false;
+        }
+        delete buffer;
+    }
+    out << "\n]}\n";
+    buffers.clear();
+    threadBuffer = nullptr;
+    return static_cast<bool>(out);
+}
+
+// Constructor: notes the start time if tracing is on
+TraceSpan::TraceSpan(const char *name, const char *category, int id)
+    : name(name), category(category), id(id), startNanos(Trace::isEnabled() ? Stats::now() : 0) {}
+
+// Destructor: records the span
+TraceSpan::~TraceSpan() {
+    if (startNanos != 0 && Trace::isEnabled()) {
+        Trace::record(name, category, id, startNanos, Stats::now());
+    }
+}
@@ -5,23 +5,151 @@
 #include "Simulation.h"
 #include "Action.h"
 #include "Auxiliary.h"
+#include "SnapshotStore.h"
+#include "Stats.h"
+#include "Trace.h"
+#include "MetricsServer.h"
+#include "CommandServer.h"
+#include "CommandInputs.h"
+#include "CommandBatcher.h"
+#include "ShardedRunner.h"
+#include "TenantHost.h"
+#include "Telemetry.h"
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
 
 using namespace std;
 
-Simulation* backup = nullptr;
+SnapshotStore* snapshots = nullptr;
 
 int main(int argc, char** argv){
-    if(argc!=2){
-        cout << "usage: simulation <config_path>" << endl;
+    // Options come in pairs after the configuration file
+    string statsPath, tracePath, metricsPath, servePath, telemetryPath;
+    vector<string> inputPaths, tenantPaths;
+    size_t batchLines = 0;
+    int shardCount = 0;
+    int telemetryInterval = 0;
+    bool validArgs = argc>=2 && argc%2==0;
+    for(int i=2; validArgs && i<argc; i+=2){
+        string option = argv[i];
+        if(option=="--stats-file") statsPath = argv[i+1];
+        else if(option=="--trace") tracePath = argv[i+1];
+        else if(option=="--metrics-socket") metricsPath = argv[i+1];
+        else if(option=="--serve") servePath = argv[i+1];
+        else if(option=="--input") inputPaths.push_back(argv[i+1]);
+        else if(option=="--batch") validArgs = (batchLines = max(atoi(argv[i+1]), 0)) > 0;
+        else if(option=="--shards") validArgs = (shardCount = atoi(argv[i+1])) > 0;
+        else if(option=="--tenant") tenantPaths.push_back(argv[i+1]);
+        else if(option=="--telemetry") telemetryPath = argv[i+1];
+        else if(option=="--telemetry-every") validArgs = (telemetryInterval = atoi(argv[i+1])) > 0;
+        else validArgs = false;
+    }
+    // Commands come from stdin, the socket's clients or the inputs, never a mix
+    if(!servePath.empty() && !inputPaths.empty()) validArgs = false;
+    // Batching only applies to stdin
+    if(batchLines>0 && (!servePath.empty() || !inputPaths.empty())) validArgs = false;
+    if(shardCount>0 && (batchLines>0 || !servePath.empty() || !inputPaths.empty())) validArgs = false;
+    // Forked workers would sample into a buffer no writer thread empties
+    if(!telemetryPath.empty() && shardCount>0) validArgs = false;
+    // The workers' counters and gauges stay in their own processes, so this one would report only the coordinator
+    if((!statsPath.empty() || !metricsPath.empty()) && shardCount>0) validArgs = false;
+    if(telemetryInterval>0 && telemetryPath.empty()) validArgs = false;
+    if(!tenantPaths.empty() && (shardCount>0 || batchLines>0 || !servePath.empty() || !inputPaths.empty())) validArgs = false;
+    // Every tenant would overwrite the same gauges, so they would show whichever one ran last
+    if(!tenantPaths.empty() && !metricsPath.empty()) validArgs = false;
+    if(!validArgs){
+        cout << "usage: simulation <config_path> [--stats-file <path>] [--trace <path>] [--metrics-socket <path>] [--telemetry <path> [--telemetry-every <ticks>]] [--serve <path> | --input <path> ... | --batch <lines> | --shards <n> | --tenant <config_path> ...]" << endl;
         return 0;
     }
+    if(!tracePath.empty()){
+        Trace::start(tracePath);
+    }
+    MetricsServer* metrics = nullptr;
+    if(!metricsPath.empty()){
+        try{
+            metrics = new MetricsServer(metricsPath);
+        }catch(const exception &e){
+            cout << e.what() << endl;
+            return 0;
+        }
+    }
+    Telemetry* telemetry = nullptr;
+    if(!telemetryPath.empty()){
+        try{
+            telemetry = new Telemetry(telemetryPath, telemetryInterval>0 ? telemetryInterval : 1);
+        }catch(const exception &e){
+            cout << e.what() << endl;
+            delete metrics;
+            return 0;
+        }
+    }
     string configurationFile = argv[1];
     Simulation simulation(configurationFile);
-    simulation.start();
-    if(backup!=nullptr){
-    	delete backup;
-    	backup = nullptr;
+    simulation.setTelemetry(telemetry);
+    if(!inputPaths.empty()){
+        // Commands come from every input at once; files are merged in a fixed order
+        try{
+            CommandInputs inputs(inputPaths);
+            inputs.run(simulation);
+        }catch(const exception &e){
+            cout << e.what() << endl;
+        }
+    }else if(!tenantPaths.empty()){
+        // Several simulations share this process and its stepping threads
+        try{
+            TenantHost host(simulation, configurationFile, tenantPaths);
+            host.run();
+        }catch(const exception &e){
+            cout << e.what() << endl;
+        }
+    }else if(shardCount>0){
+        // Plans are split across worker processes
+        try{
+            ShardedRunner runner(simulation, shardCount);
+            runner.run();
+        }catch(const exception &e){
+            cout << e.what() << endl;
+        }
+    }else if(batchLines>0){
+        CommandBatcher batcher(simulation, batchLines);
+        batcher.run();
+    }else if(servePath.empty()){
+        simulation.start();
+    }else{
+        // Commands come from the clients of the socket instead of stdin
+        try{
+            CommandServer server(servePath);
+            server.run(simulation);
+        }catch(const exception &e){
+            cout << e.what() << endl;
+        }
+    }
+    if(telemetry!=nullptr){
+        // A background run may still be stepping
+        simulation.setTelemetry(nullptr);
+        if(!telemetry->finish()){
+            cout << "Unable to write telemetry file" << endl;
+        }
+        delete telemetry;
+        telemetry = nullptr;
+    }
+    if(metrics!=nullptr){
+        delete metrics;
+        metrics = nullptr;
+    }
+    if(!statsPath.empty()){
+        // Dump the statistics once the simulation is closed
+        ofstream statsFile(statsPath);
+        statsFile << Stats::toString();
+    }
+    if(!Trace::finish()){
+        cout << "Unable to write trace file" << endl;
+    }
+    if(snapshots!=nullptr){
+    	delete snapshots;
+    	snapshots = nullptr;
     }
     return 0;
 }
\ No newline at end of file